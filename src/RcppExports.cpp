@@ -62,6 +62,46 @@ BEGIN_RCPP
     return R_NilValue;
 END_RCPP
 }
+// gc_set_streaming_mode
+void gc_set_streaming_mode(std::string mode);
+RcppExport SEXP _gdalcubes_gc_set_streaming_mode(SEXP modeSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type mode(modeSEXP);
+    gc_set_streaming_mode(mode);
+    return R_NilValue;
+END_RCPP
+}
+// gc_set_chunk_order
+void gc_set_chunk_order(std::string order);
+RcppExport SEXP _gdalcubes_gc_set_chunk_order(SEXP orderSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type order(orderSEXP);
+    gc_set_chunk_order(order);
+    return R_NilValue;
+END_RCPP
+}
+// gc_set_chunk_cache_size
+void gc_set_chunk_cache_size(double size_mb);
+RcppExport SEXP _gdalcubes_gc_set_chunk_cache_size(SEXP size_mbSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< double >::type size_mb(size_mbSEXP);
+    gc_set_chunk_cache_size(size_mb);
+    return R_NilValue;
+END_RCPP
+}
+// gc_chunk_cache_stats
+Rcpp::List gc_chunk_cache_stats();
+RcppExport SEXP _gdalcubes_gc_chunk_cache_stats() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(gc_chunk_cache_stats());
+    return rcpp_result_gen;
+END_RCPP
+}
 // gc_gdalversion
 std::string gc_gdalversion();
 RcppExport SEXP _gdalcubes_gc_gdalversion() {
@@ -614,6 +654,18 @@ BEGIN_RCPP
     return R_NilValue;
 END_RCPP
 }
+// gc_eval_array
+Rcpp::NumericVector gc_eval_array(SEXP pin, bool band_fastest);
+RcppExport SEXP _gdalcubes_gc_eval_array(SEXP pinSEXP, SEXP band_fastestSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type pin(pinSEXP);
+    Rcpp::traits::input_parameter< bool >::type band_fastest(band_fastestSEXP);
+    rcpp_result_gen = Rcpp::wrap(gc_eval_array(pin, band_fastest));
+    return rcpp_result_gen;
+END_RCPP
+}
 // gc_write_chunks_ncdf
 void gc_write_chunks_ncdf(SEXP pin, std::string dir, std::string name, uint8_t compression_level);
 RcppExport SEXP _gdalcubes_gc_write_chunks_ncdf(SEXP pinSEXP, SEXP dirSEXP, SEXP nameSEXP, SEXP compression_levelSEXP) {
@@ -859,6 +911,10 @@ static const R_CallMethodDef CallEntries[] = {
     {"_gdalcubes_gc_gdalformats", (DL_FUNC) &_gdalcubes_gc_gdalformats, 0},
     {"_gdalcubes_gc_set_gdal_config", (DL_FUNC) &_gdalcubes_gc_set_gdal_config, 2},
     {"_gdalcubes_gc_set_streamining_dir", (DL_FUNC) &_gdalcubes_gc_set_streamining_dir, 1},
+    {"_gdalcubes_gc_set_streaming_mode", (DL_FUNC) &_gdalcubes_gc_set_streaming_mode, 1},
+    {"_gdalcubes_gc_set_chunk_order", (DL_FUNC) &_gdalcubes_gc_set_chunk_order, 1},
+    {"_gdalcubes_gc_set_chunk_cache_size", (DL_FUNC) &_gdalcubes_gc_set_chunk_cache_size, 1},
+    {"_gdalcubes_gc_chunk_cache_stats", (DL_FUNC) &_gdalcubes_gc_chunk_cache_stats, 0},
     {"_gdalcubes_gc_gdalversion", (DL_FUNC) &_gdalcubes_gc_gdalversion, 0},
     {"_gdalcubes_gc_gdal_has_geos", (DL_FUNC) &_gdalcubes_gc_gdal_has_geos, 0},
     {"_gdalcubes_gc_add_format_dir", (DL_FUNC) &_gdalcubes_gc_add_format_dir, 1},
@@ -903,6 +959,7 @@ static const R_CallMethodDef CallEntries[] = {
     {"_gdalcubes_gc_create_filter_geom_cube", (DL_FUNC) &_gdalcubes_gc_create_filter_geom_cube, 3},
     {"_gdalcubes_gc_set_err_handler", (DL_FUNC) &_gdalcubes_gc_set_err_handler, 2},
     {"_gdalcubes_gc_eval_cube", (DL_FUNC) &_gdalcubes_gc_eval_cube, 6},
+    {"_gdalcubes_gc_eval_array", (DL_FUNC) &_gdalcubes_gc_eval_array, 2},
     {"_gdalcubes_gc_write_chunks_ncdf", (DL_FUNC) &_gdalcubes_gc_write_chunks_ncdf, 4},
     {"_gdalcubes_gc_write_tif", (DL_FUNC) &_gdalcubes_gc_write_tif, 8},
     {"_gdalcubes_gc_create_stream_cube", (DL_FUNC) &_gdalcubes_gc_create_stream_cube, 2},
@@ -1,4 +1,5 @@
 #include "gdalcubes/src/gdalcubes.h"
+#include "gdalcubes/src/chunk_cache.h"
 #include "gdalcubes/src/cube_factory.h"
 #include "multiprocess.h"
 #include "error.h"
@@ -260,6 +261,52 @@ void gc_set_streamining_dir(std::string dir) {
   config::instance()->set_streaming_dir(dir);
 }
 
+// [[Rcpp::export]]
+void gc_set_streaming_mode(std::string mode) {
+  if (mode == "file") {
+    config::instance()->set_streaming_mode(streaming_mode::FILES);
+  } else if (mode == "pipe") {
+    config::instance()->set_streaming_mode(streaming_mode::PIPE);
+  } else if (mode == "persistent") {
+    config::instance()->set_streaming_mode(streaming_mode::PERSISTENT);
+  } else {
+    Rcpp::stop("Invalid streaming mode; expected one of 'file', 'pipe', or 'persistent'");
+  }
+}
+
+// [[Rcpp::export]]
+void gc_set_chunk_order(std::string order) {
+  if (order == "auto") {
+    config::instance()->set_chunk_order(chunk_order::AUTO);
+  } else if (order == "id") {
+    config::instance()->set_chunk_order(chunk_order::ID);
+  } else if (order == "time_first") {
+    config::instance()->set_chunk_order(chunk_order::TIME_FIRST);
+  } else if (order == "zorder") {
+    config::instance()->set_chunk_order(chunk_order::ZORDER);
+  } else {
+    Rcpp::stop("Invalid chunk order; expected one of 'auto', 'id', 'time_first', or 'zorder'");
+  }
+}
+
+// [[Rcpp::export]]
+void gc_set_chunk_cache_size(double size_mb) {
+  config::instance()->set_server_chunkcache_max((uint64_t)(size_mb * 1024 * 1024));
+  // cached chunks might exceed the new limit
+  chunk_cache::instance()->clear();
+}
+
+// [[Rcpp::export]]
+Rcpp::List gc_chunk_cache_stats() {
+  chunk_cache::stats s = chunk_cache::instance()->get_stats();
+  return Rcpp::List::create(
+    Rcpp::Named("hits") = (double)s.hits,
+    Rcpp::Named("misses") = (double)s.misses,
+    Rcpp::Named("evictions") = (double)s.evictions,
+    Rcpp::Named("count") = (double)s.count,
+    Rcpp::Named("size_mb") = (double)s.size_bytes / (1024.0 * 1024.0));
+}
+
 
 // [[Rcpp::export]]
 std::string gc_gdalversion() {
@@ -1374,6 +1421,32 @@ void gc_eval_cube( SEXP pin, std::string outfile, uint8_t compression_level=0, b
   }
 }
 
+// [[Rcpp::export]]
+Rcpp::NumericVector gc_eval_array(SEXP pin, bool band_fastest = false) {
+  try {
+    Rcpp::XPtr< std::shared_ptr<cube> > aa = Rcpp::as<Rcpp::XPtr< std::shared_ptr<cube> >>(pin);
+    std::shared_ptr<cube> x = *aa;
+    int nb = x->size_bands();
+    int nt = x->size_t();
+    int ny = x->size_y();
+    int nx = x->size_x();
+    
+    // chunks are written directly into the R vector, without intermediate files or copies
+    Rcpp::NumericVector out = Rcpp::no_init((R_xlen_t)nb * nt * ny * nx);
+    x->to_double_array(REAL(out), band_fastest);
+    if (band_fastest) {
+      out.attr("dim") = Rcpp::IntegerVector::create(nb, nt, ny, nx);
+    }
+    else {
+      out.attr("dim") = Rcpp::IntegerVector::create(nx, ny, nt, nb);
+    }
+    return out;
+  }
+  catch (std::string s) {
+    Rcpp::stop(s);
+  }
+}
+
 // [[Rcpp::export]]
 void gc_write_chunks_ncdf( SEXP pin, std::string dir, std::string name, uint8_t compression_level=0) {
   try {
@@ -24,6 +24,7 @@
 
 
 #include "aggregate_space.h"
+#include "quantile.h"
 
 
 
@@ -189,7 +190,7 @@ struct count_aggregtor_space_slice_singleband : public aggregator_space_slice_si
 
 struct median_aggregtor_space_slice_singleband : public aggregator_space_slice_singleband {
     void init(double *out, uint32_t size_t, uint32_t size_y, uint32_t size_x) override {
-        _m_buckets.resize(size_t * size_x *size_y, std::vector<double>());
+        _values = std::make_shared<gdalcubes::value_arena>(size_t * size_x *size_y);
         for (uint32_t ixyt = 0; ixyt < size_t *size_x *size_y; ++ixyt) {
             out[ixyt] = NAN;
         }
@@ -201,25 +202,18 @@ struct median_aggregtor_space_slice_singleband : public aggregator_space_slice_s
 
         if (!std::isnan(*v)) {
             uint32_t ixyt = it * size_y * size_x + iy * size_x + ix;
-            _m_buckets[ixyt].push_back(*v);
+            _values->push(ixyt, *v);
         }
     }
 
     void finalize(double *out, uint32_t size_t, uint32_t size_y, uint32_t size_x) override {
         for (uint32_t ixyt = 0; ixyt < size_t * size_x * size_y; ++ixyt) {
-            std::vector<double> &list = _m_buckets[ixyt];
-            std::sort(list.begin(), list.end());
-            if (list.size() == 0) {
-                out[ixyt] = NAN;
-            } else if (list.size() % 2 == 1) {
-                out[ixyt] = list[list.size() / 2];
-            } else {
-                out[ixyt] = (list[list.size() / 2] + list[list.size() / 2 - 1]) / ((double)2);
-            }
+            out[ixyt] = gdalcubes::quantiles::median(_values->values(ixyt), _values->count(ixyt));
         }
+        _values.reset();
     }
    private:
-    std::vector<std::vector<double>> _m_buckets;
+    std::shared_ptr<gdalcubes::value_arena> _values;
 };
 
 
@@ -114,6 +114,11 @@ class aggregate_space_cube : public cube {
 
     std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
 
+    chunk_order suggest_chunk_order() override {
+        // spatially neighbouring output chunks read neighbouring input chunks, which may share blocks of source images
+        return chunk_order::ZORDER;
+    }
+
     /**
  * Combines all chunks and produces a single GDAL image
  * @param path path to output image file
@@ -23,6 +23,8 @@
 */
 #include "aggregate_time.h"
 
+#include "quantile.h"
+
 
 
 struct aggregator_time_slice_singleband {
@@ -192,7 +194,7 @@ struct count_aggregtor_time_slice_singleband : public aggregator_time_slice_sing
 
 struct median_aggregtor_time_slice_singleband : public aggregator_time_slice_singleband {
     void init(double *out, uint32_t size_x, uint32_t size_y) override {
-        _m_buckets.resize(size_x *size_y, std::vector<double>());
+        _values = std::make_shared<gdalcubes::value_arena>(size_x * size_y);
         for (uint32_t ixy = 0; ixy < size_x *size_y; ++ixy) {
             out[ixy] = NAN;
         }
@@ -202,26 +204,19 @@ struct median_aggregtor_time_slice_singleband : public aggregator_time_slice_sin
         for (uint32_t ixy = 0; ixy < size_x * size_y; ++ixy) {
             double v = in[ixy];
             if (!std::isnan(v)) {
-                _m_buckets[ixy].push_back(v);
+                _values->push(ixy, v);
             }
         }
     }
 
     void finalize(double *out, uint32_t size_x, uint32_t size_y) override {
         for (uint32_t ixy = 0; ixy < size_x * size_y; ++ixy) {
-            std::vector<double> &list = _m_buckets[ixy];
-            std::sort(list.begin(), list.end());
-            if (list.size() == 0) {
-                out[ixy] = NAN;
-            } else if (list.size() % 2 == 1) {
-                out[ixy] = list[list.size() / 2];
-            } else {
-                out[ixy] = (list[list.size() / 2] + list[list.size() / 2 - 1]) / ((double)2);
-            }
+            out[ixy] = gdalcubes::quantiles::median(_values->values(ixy), _values->count(ixy));
         }
+        _values.reset();
     }
    private:
-    std::vector<std::vector<double>> _m_buckets;
+    std::shared_ptr<gdalcubes::value_arena> _values;
 };
 
 
@@ -392,7 +387,7 @@ std::shared_ptr<chunk_data> aggregate_time_cube::read_chunk(chunkid_t id) {
             chunkid_t cur_in_chunk = _in_cube->chunk_id_from_coords(in_ccords);
 
             if (chunk_cache.find(cur_in_chunk) == chunk_cache.end()) {
-                chunk_cache[cur_in_chunk] = _in_cube->read_chunk(cur_in_chunk);
+                chunk_cache[cur_in_chunk] = _in_cube->read_chunk_cached(cur_in_chunk);
                 // TODO: remove old chunk from "cache" and use a single pointer instead of map?!
             }
 
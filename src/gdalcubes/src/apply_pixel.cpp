@@ -24,8 +24,6 @@
 
 #include "apply_pixel.h"
 
-#include "external/tinyexpr/tinyexpr.h"
-
 #include <cstring>
 
 namespace gdalcubes {
@@ -44,49 +42,6 @@ std::shared_ptr<chunk_data> apply_pixel_cube::read_chunk(chunkid_t id) {
         return out;
     }
 
-    // Parse expressions and create symbol table
-    std::vector<double> values;
-    values.resize(_in_cube->bands().count() + 9, NAN);
-    // CAUTION: never change size of values from now
-
-    // Add further variables like x, y, t to symbol table
-    std::vector<te_variable> vars;
-    for (uint16_t i = 0; i < _in_cube->bands().count(); ++i) {
-        char* varname = new char[_in_cube->bands().get(i).name.length() + 1];
-        std::string temp_name = _in_cube->bands().get(i).name;
-        std::transform(temp_name.begin(), temp_name.end(), temp_name.begin(), ::tolower);
-        std::strncpy(varname, temp_name.c_str(), temp_name.length() + 1);
-        vars.push_back({varname, &values[i]});
-    }
-    vars.push_back({"t0", &values[_in_cube->bands().count() + 0]});
-    vars.push_back({"t1", &values[_in_cube->bands().count() + 1]});
-    vars.push_back({"left", &values[_in_cube->bands().count() + 2]});
-    vars.push_back({"right", &values[_in_cube->bands().count() + 3]});
-    vars.push_back({"top", &values[_in_cube->bands().count() + 4]});
-    vars.push_back({"bottom", &values[_in_cube->bands().count() + 5]});
-    vars.push_back({"ix", &values[_in_cube->bands().count() + 6]});
-    vars.push_back({"iy", &values[_in_cube->bands().count() + 7]});
-    vars.push_back({"it", &values[_in_cube->bands().count() + 8]});
-
-    std::vector<te_expr*> expr;
-    for (uint16_t i = 0; i < _expr.size(); ++i) {
-        int err;
-
-        te_expr* x = te_compile(_expr[i].c_str(), vars.data(), vars.size(), &err);
-        if (!x) {
-            std::string msg = "Cannot parse expression for " + _bands.get(i).name + " '" + _expr[i] + "': error at token " + std::to_string(err);
-            GCBS_ERROR(msg);
-
-            // free other expressions
-            for (uint16_t j = 0; j < expr.size(); ++j) {
-                te_free(expr[j]);
-            }
-            return out;
-        } else {
-            expr.push_back(x);
-        }
-    }
-
     out->size({_bands.count(), in->size()[1], in->size()[2], in->size()[3]});
     out->buf(std::calloc(_bands.count() * in->size()[1] * in->size()[2] * in->size()[3], sizeof(double)));
 
@@ -100,68 +55,98 @@ std::shared_ptr<chunk_data> apply_pixel_cube::read_chunk(chunkid_t id) {
                     sizeof(double) * in->size()[0] * in->size()[1] * in->size()[2] * in->size()[3]);
     }
 
-    uint16_t outb = (_keep_bands) ? _in_cube->size_bands() : 0;
-    uint16_t expr_idx = 0;
-    while (outb < _bands.count()) {
-        std::vector<uint16_t> bidx;
-        for (auto it = _band_usage[expr_idx].begin(); it != _band_usage[expr_idx].end(); ++it) {
-            bidx.push_back(_in_cube->bands().get_index(*it));
+    uint16_t nb = _in_cube->bands().count();
+    uint32_t nt = in->size()[1];
+    uint32_t ny = in->size()[2];
+    uint32_t nx = in->size()[3];
+    uint32_t npix = nt * ny * nx;
+    double* in_buf = (double*)in->buf();
+    double* out_buf = (double*)out->buf() + ((_keep_bands) ? nb * npix : 0);
+
+    // Variables after bands are t0, t1, left, right, top, bottom, ix, iy, it
+    std::vector<bool> used(nb + 9, false);
+    for (uint16_t i = 0; i < _compiled.size(); ++i) {
+        for (uint16_t v = 0; v < nb + 9; ++v) {
+            if (_compiled[i]->uses(v)) used[v] = true;
         }
-        for (uint32_t i = 0; i < in->size()[1] * in->size()[2] * in->size()[3]; ++i) {
-            for (uint16_t inb = 0; inb < bidx.size(); ++inb) {
-                values[bidx[inb]] = ((double*)in->buf())[bidx[inb] * in->size()[1] * in->size()[2] * in->size()[3] + i];
-            }
+    }
+    bool pixel_vars = false;
+    for (uint16_t v = nb; v < nb + 9; ++v) {
+        pixel_vars = pixel_vars || used[v];
+    }
 
-            // additional variables
-            if (_var_usage[expr_idx].count("it") || _var_usage[expr_idx].count("t0") || _var_usage[expr_idx].count("t1")) {
-                values[_in_cube->bands().count() + 8] = (double)(_in_cube->chunk_limits(id).low[0] + (i / (in->size()[2] * in->size()[3])));  // _t
-            }
-            if (_var_usage[expr_idx].count("t0")) {
-                values[_in_cube->bands().count() + 0] = (_in_cube->st_reference()->datetime_at_index((int)(values[_in_cube->bands().count() + 8]))).epoch_time();
-            }
-            if (_var_usage[expr_idx].count("t1")) {
-                values[_in_cube->bands().count() + 1] = (_in_cube->st_reference()->datetime_at_index((int)(values[_in_cube->bands().count() + 8] + 1))).epoch_time();
-            }
+    std::vector<const double*> vars(nb + 9, nullptr);
+    if (!pixel_vars) {
+        // evaluate whole chunk at once
+        for (uint16_t b = 0; b < nb; ++b) {
+            vars[b] = in_buf + b * npix;
+        }
+        for (uint16_t i = 0; i < _compiled.size(); ++i) {
+            _compiled[i]->eval(vars, npix, out_buf + i * npix);
+        }
+        return out;
+    }
 
-            if (_var_usage[expr_idx].count("ix") || _var_usage[expr_idx].count("left") || _var_usage[expr_idx].count("right")) {
-                values[_in_cube->bands().count() + 6] = (double)(_in_cube->chunk_limits(id).low[2] + (i % in->size()[3]));
-            }
-            if (_var_usage[expr_idx].count("iy") || _var_usage[expr_idx].count("top") || _var_usage[expr_idx].count("bottom")) {
-                // values[_in_cube->bands().count() + 7] = (double)(_in_cube->size_y() - 1 - (_in_cube->chunk_limits(id).high[1] - ((i / in->size()[3]) % in->size()[2])));
-                values[_in_cube->bands().count() + 7] = (double)(_in_cube->chunk_limits(id).low[1] + ((i / in->size()[3]) % in->size()[2]));
-            }
+    // evaluate row by row, values of additional variables for one row are stored in aux
+    std::vector<double> aux(9 * nx, NAN);
+    for (uint16_t v = 0; v < 9; ++v) {
+        vars[nb + v] = aux.data() + v * nx;
+    }
+    double* t0 = aux.data() + 0 * nx;
+    double* t1 = aux.data() + 1 * nx;
+    double* left = aux.data() + 2 * nx;
+    double* right = aux.data() + 3 * nx;
+    double* top = aux.data() + 4 * nx;
+    double* bottom = aux.data() + 5 * nx;
+    double* ix = aux.data() + 6 * nx;
+    double* iy = aux.data() + 7 * nx;
+    double* it = aux.data() + 8 * nx;
+
+    bounds_nd<uint32_t, 3> climits = _in_cube->chunk_limits(id);
+    bool regular_space = _in_cube->st_reference()->has_regular_space();
+
+    // column dependent variables are the same for all rows
+    for (uint32_t x = 0; x < nx; ++x) {
+        ix[x] = (double)(climits.low[2] + x);
+        if (regular_space) {
+            left[x] = _in_cube->st_reference()->left() + _in_cube->st_reference()->dx() * ix[x];
+            right[x] = _in_cube->st_reference()->left() + _in_cube->st_reference()->dx() * (ix[x] + 1);
+        }
+    }
 
-            if (_in_cube->st_reference()->has_regular_space()) {
-                if (_var_usage[expr_idx].count("left")) {
-                    values[_in_cube->bands().count() + 2] = _in_cube->st_reference()->left() +
-                                                            _in_cube->st_reference()->dx() * values[_in_cube->bands().count() + 6];
-                }
-                if (_var_usage[expr_idx].count("right")) {
-                    values[_in_cube->bands().count() + 3] = _in_cube->st_reference()->left() +
-                                                            _in_cube->st_reference()->dx() * (values[_in_cube->bands().count() + 6] + 1);
-                }
-                if (_var_usage[expr_idx].count("top")) {
-                    values[_in_cube->bands().count() + 4] = _in_cube->st_reference()->top() -
-                                                            _in_cube->st_reference()->dy() * values[_in_cube->bands().count() + 7];
+    for (uint32_t t = 0; t < nt; ++t) {
+        int it_cube = (int)(climits.low[0] + t);
+        if (used[nb + 8]) {
+            std::fill(it, it + nx, (double)it_cube);
+        }
+        if (used[nb + 0]) {
+            std::fill(t0, t0 + nx, (double)(_in_cube->st_reference()->datetime_at_index(it_cube)).epoch_time());
+        }
+        if (used[nb + 1]) {
+            std::fill(t1, t1 + nx, (double)(_in_cube->st_reference()->datetime_at_index(it_cube + 1)).epoch_time());
+        }
+        for (uint32_t y = 0; y < ny; ++y) {
+            double iy_cube = (double)(climits.low[1] + y);
+            if (used[nb + 7]) {
+                std::fill(iy, iy + nx, iy_cube);
+            }
+            if (regular_space) {
+                if (used[nb + 4]) {
+                    std::fill(top, top + nx, _in_cube->st_reference()->top() - _in_cube->st_reference()->dy() * iy_cube);
                 }
-                if (_var_usage[expr_idx].count("bottom")) {
-                    values[_in_cube->bands().count() + 5] = _in_cube->st_reference()->top() -
-                                                            _in_cube->st_reference()->dy() * (values[_in_cube->bands().count() + 7] + 1);
+                if (used[nb + 5]) {
+                    std::fill(bottom, bottom + nx, _in_cube->st_reference()->top() - _in_cube->st_reference()->dy() * (iy_cube + 1));
                 }
             }
-            ((double*)out->buf())[outb * in->size()[1] * in->size()[2] * in->size()[3] + i] = te_eval(expr[expr_idx]);
-        }
-        ++outb;
-        ++expr_idx;
-    }
 
-    // free expressions
-    for (uint16_t j = 0; j < expr.size(); ++j) {
-        te_free(expr[j]);
-    }
-    // free varnames
-    for (uint16_t i = 0; i < _in_cube->bands().count(); ++i) {
-        delete[] vars[i].name;  // delete only names of band variables
+            uint32_t offset = (t * ny + y) * nx;
+            for (uint16_t b = 0; b < nb; ++b) {
+                vars[b] = in_buf + b * npix + offset;
+            }
+            for (uint16_t i = 0; i < _compiled.size(); ++i) {
+                _compiled[i]->eval(vars, nx, out_buf + i * npix + offset);
+            }
+        }
     }
 
     return out;
@@ -169,42 +154,25 @@ std::shared_ptr<chunk_data> apply_pixel_cube::read_chunk(chunkid_t id) {
 
 bool apply_pixel_cube::parse_expressions() {
     bool res = true;
-    std::vector<double> dummy_values;
-    dummy_values.resize(_in_cube->bands().count() + 9, 1.0);
-    std::vector<te_variable> vars;
+    std::vector<std::string> vars;
     for (uint16_t i = 0; i < _in_cube->bands().count(); ++i) {
-        char* varname = new char[_in_cube->bands().get(i).name.length() + 1];
         std::string temp_name = _in_cube->bands().get(i).name;
         std::transform(temp_name.begin(), temp_name.end(), temp_name.begin(), ::tolower);
-        std::strncpy(varname, temp_name.c_str(), temp_name.length() + 1);
-        vars.push_back({varname, &dummy_values[i]});
+        vars.push_back(temp_name);
     }
+    vars.insert(vars.end(), {"t0", "t1", "left", "right", "top", "bottom", "ix", "iy", "it"});
 
-    vars.push_back({"t0", &dummy_values[_in_cube->bands().count() + 0]});
-    vars.push_back({"t1", &dummy_values[_in_cube->bands().count() + 1]});
-    vars.push_back({"left", &dummy_values[_in_cube->bands().count() + 2]});
-    vars.push_back({"right", &dummy_values[_in_cube->bands().count() + 3]});
-    vars.push_back({"top", &dummy_values[_in_cube->bands().count() + 4]});
-    vars.push_back({"bottom", &dummy_values[_in_cube->bands().count() + 5]});
-    vars.push_back({"ix", &dummy_values[_in_cube->bands().count() + 6]});
-    vars.push_back({"iy", &dummy_values[_in_cube->bands().count() + 7]});
-    vars.push_back({"it", &dummy_values[_in_cube->bands().count() + 8]});
-
-    int err = 0;
+    _compiled.clear();
     for (uint16_t i = 0; i < _expr.size(); ++i) {
-        te_expr* expr = te_compile(_expr[i].c_str(), vars.data(), vars.size(), &err);
-        if (expr) {
-            te_free(expr);
-        } else {
+        try {
+            _compiled.push_back(std::make_shared<pixel_expression>(_expr[i], vars));
+        } catch (std::string err) {
             res = false;
-            std::string msg = "Cannot parse expression for " + _bands.get(i).name + " '" + _expr[i] + "': error at token " + std::to_string(err);
+            std::string msg = "Cannot parse expression for " + _bands.get(i).name + " '" + _expr[i] + "': " + err;
             GCBS_ERROR(msg);
             // Continue anyway to process all expressions
         }
     }
-    for (uint16_t i = 0; i < _in_cube->bands().count(); ++i) {
-        delete[] vars[i].name;  // delete only names of band variables
-    }
     return res;
 }
 
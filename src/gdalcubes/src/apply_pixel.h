@@ -27,9 +27,9 @@
 
 #include <algorithm>
 #include <string>
-#include <unordered_set>
 
 #include "cube.h"
+#include "pixel_expression.h"
 
 namespace gdalcubes {
 
@@ -66,7 +66,7 @@ class apply_pixel_cube : public cube {
      * @param band_names specify names for the bands of the resulting cube, if empty, "band1", "band2", "band3", etc. will be used as names
      * @param keep_bands if true, bands will be added to the existing bands of the input cube, otherwise (default) they are dropped
      */
-    apply_pixel_cube(std::shared_ptr<cube> in, std::vector<std::string> expr, std::vector<std::string> band_names = {}, bool keep_bands = false) : cube(in->st_reference()->copy()), _in_cube(in), _expr(expr), _band_names(band_names), _band_usage(), _band_usage_all(), _keep_bands(keep_bands) {  // it is important to duplicate st reference here, otherwise changes will affect input cube as well
+    apply_pixel_cube(std::shared_ptr<cube> in, std::vector<std::string> expr, std::vector<std::string> band_names = {}, bool keep_bands = false) : cube(in->st_reference()->copy()), _in_cube(in), _expr(expr), _band_names(band_names), _compiled(), _keep_bands(keep_bands) {  // it is important to duplicate st reference here, otherwise changes will affect input cube as well
         _chunk_size[0] = _in_cube->chunk_size()[0];
         _chunk_size[1] = _in_cube->chunk_size()[1];
         _chunk_size[2] = _in_cube->chunk_size()[2];
@@ -103,40 +103,11 @@ class apply_pixel_cube : public cube {
             std::transform(_expr[i].begin(), _expr[i].end(), _expr[i].begin(), ::tolower);
         }
 
-        // parse expressions, currently this is only for validation,
-        // expressions will be parsed again in read_chunk(), costs should
-        // be negligible compared to the actual evaluation
+        // expressions are compiled once and evaluated for all chunks
         if (!parse_expressions()) {
             GCBS_ERROR("Invalid expression(s)");
             throw std::string("ERROR in apply_pixel_cube::apply_pixel_cube(): Invalid expression(s)");
         }
-
-        // Find out, which bands are actually used per expression
-        for (uint16_t i = 0; i < _expr.size(); ++i) {
-            _band_usage.push_back(std::unordered_set<std::string>());
-            for (uint16_t ib = 0; ib < _in_cube->bands().count(); ++ib) {
-                std::string name = _in_cube->bands().get(ib).name;
-                std::string temp_name = name;
-
-                // tinyexpr works with lower case symbols only
-                std::transform(temp_name.begin(), temp_name.end(), temp_name.begin(), ::tolower);
-
-                if (_expr[i].find(temp_name) != std::string::npos) {
-                    _band_usage[i].insert(name);
-                    _band_usage_all.insert(name);
-                }
-            }
-            _var_usage.push_back(std::unordered_set<std::string>());
-            if (_expr[i].find("ix") != std::string::npos) _var_usage[i].insert("ix");
-            if (_expr[i].find("iy") != std::string::npos) _var_usage[i].insert("iy");
-            if (_expr[i].find("it") != std::string::npos) _var_usage[i].insert("it");
-            if (_expr[i].find("left") != std::string::npos) _var_usage[i].insert("left");
-            if (_expr[i].find("right") != std::string::npos) _var_usage[i].insert("right");
-            if (_expr[i].find("top") != std::string::npos) _var_usage[i].insert("top");
-            if (_expr[i].find("bottom") != std::string::npos) _var_usage[i].insert("bottom");
-            if (_expr[i].find("t0") != std::string::npos) _var_usage[i].insert("t0");
-            if (_expr[i].find("t1") != std::string::npos) _var_usage[i].insert("t1");
-        }
     }
 
    public:
@@ -159,10 +130,7 @@ class apply_pixel_cube : public cube {
     std::shared_ptr<cube> _in_cube;
     std::vector<std::string> _expr;
     std::vector<std::string> _band_names;
-    std::vector<std::unordered_set<std::string>> _band_usage;  // store which bands are really used per expression
-    std::unordered_set<std::string> _band_usage_all;
-
-    std::vector<std::unordered_set<std::string>> _var_usage;
+    std::vector<std::shared_ptr<pixel_expression>> _compiled;
 
     bool _keep_bands;
 
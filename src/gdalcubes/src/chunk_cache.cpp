@@ -0,0 +1,185 @@
+/*
+    MIT License
+
+    Copyright (c) 2026 Marius Appel <marius.appel@hs-bochum.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "chunk_cache.h"
+
+namespace gdalcubes {
+
+std::shared_ptr<chunk_data> chunk_cache::get(uint64_t cube_uid, chunkid_t id) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto it = _index.find(key(cube_uid, id));
+    if (it == _index.end()) {
+        ++_misses;
+        return nullptr;
+    }
+    ++_hits;
+    // move to front
+    _entries.splice(_entries.begin(), _entries, it->second);
+    std::shared_ptr<chunk_data> c = it->second->second;
+    lock.unlock();
+    if (c->type() != chunk_data::value_type::FLOAT64) {
+        return promote(key(cube_uid, id), c);
+    }
+    return c;
+}
+
+std::shared_ptr<chunk_data> chunk_cache::get_or_read(uint64_t cube_uid, chunkid_t id, std::function<std::shared_ptr<chunk_data>()> read) {
+    key k(cube_uid, id);
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto it = _index.find(k);
+    if (it != _index.end()) {
+        ++_hits;
+        _entries.splice(_entries.begin(), _entries, it->second);
+        std::shared_ptr<chunk_data> c = it->second->second;
+        lock.unlock();
+        if (c->type() != chunk_data::value_type::FLOAT64) {
+            return promote(k, c);
+        }
+        return c;
+    }
+    auto ip = _pending.find(k);
+    if (ip != _pending.end()) {
+        // another thread reads the chunk, wait for its result
+        ++_hits;
+        std::shared_future<std::shared_ptr<chunk_data>> f = ip->second;
+        lock.unlock();
+        return f.get();
+    }
+    ++_misses;
+    std::promise<std::shared_ptr<chunk_data>> p;
+    _pending[k] = p.get_future().share();
+    lock.unlock();
+
+    std::shared_ptr<chunk_data> c;
+    try {
+        c = read();
+    } catch (...) {
+        p.set_exception(std::current_exception());
+        std::lock_guard<std::mutex> lock_pending(_mutex);
+        _pending.erase(k);
+        throw;
+    }
+    // do not cache failed reads, errors might be temporary (e.g. network issues)
+    if (c->status() != chunk_data::chunk_status::ERROR) {
+        put(cube_uid, id, c);
+    }
+    p.set_value(c);
+    std::lock_guard<std::mutex> lock_pending(_mutex);
+    _pending.erase(k);
+    return c;
+}
+
+void chunk_cache::put(uint64_t cube_uid, chunkid_t id, std::shared_ptr<chunk_data> c) {
+    uint64_t max_size_bytes = config::instance()->get_server_chunkcache_max();
+    if (max_size_bytes == 0) {
+        return;
+    }
+    // store a compact copy if possible, e.g. for integer data
+    std::shared_ptr<chunk_data> cc = c->compact();
+    if (cc) {
+        c = cc;
+    }
+    uint64_t c_size = c->total_size_bytes();
+    if (c_size > max_size_bytes) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    key k(cube_uid, id);
+    auto it = _index.find(k);
+    if (it != _index.end()) {
+        // chunk has been computed concurrently by another thread, keep the newer one
+        _size_bytes -= it->second->second->total_size_bytes();
+        _entries.erase(it->second);
+        _index.erase(it);
+    }
+    evict(max_size_bytes - c_size);
+    _entries.push_front(std::make_pair(k, c));
+    _index[k] = _entries.begin();
+    _size_bytes += c_size;
+}
+
+void chunk_cache::remove(uint64_t cube_uid) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto it = _entries.begin(); it != _entries.end();) {
+        if (it->first.first == cube_uid) {
+            _size_bytes -= it->second->total_size_bytes();
+            _index.erase(it->first);
+            it = _entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void chunk_cache::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.clear();
+    _index.clear();
+    _size_bytes = 0;
+}
+
+chunk_cache::stats chunk_cache::get_stats() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    stats s;
+    s.hits = _hits;
+    s.misses = _misses;
+    s.evictions = _evictions;
+    s.size_bytes = _size_bytes;
+    s.count = _entries.size();
+    return s;
+}
+
+std::shared_ptr<chunk_data> chunk_cache::promote(const key& k, std::shared_ptr<chunk_data> c) {
+    // expects _mutex to be unlocked by the caller
+    std::shared_ptr<chunk_data> p = c->promote();
+    uint64_t max_size_bytes = config::instance()->get_server_chunkcache_max();
+    uint64_t p_size = p->total_size_bytes();
+    if (p_size > max_size_bytes) {
+        return p;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _index.find(k);
+    if (it == _index.end() || it->second->second != c) {
+        return p;  // chunk has been evicted or promoted by another thread meanwhile
+    }
+    // chunk has been read at least twice, keep the FLOAT64 version such that further hits do not copy
+    it->second->second = p;
+    _size_bytes += p_size - c->total_size_bytes();
+    _entries.splice(_entries.begin(), _entries, it->second);
+    evict(max_size_bytes);
+    return p;
+}
+
+void chunk_cache::evict(uint64_t max_size_bytes) {
+    // expects _mutex to be locked by the caller
+    while (!_entries.empty() && _size_bytes > max_size_bytes) {
+        _size_bytes -= _entries.back().second->total_size_bytes();
+        _index.erase(_entries.back().first);
+        _entries.pop_back();
+        ++_evictions;
+    }
+}
+
+}  // namespace gdalcubes
@@ -0,0 +1,148 @@
+/*
+    MIT License
+
+    Copyright (c) 2026 Marius Appel <marius.appel@hs-bochum.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef CHUNK_CACHE_H
+#define CHUNK_CACHE_H
+
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "cube.h"
+
+namespace gdalcubes {
+
+/**
+ * @brief Process-wide, memory-bounded LRU cache for chunks of intermediate data cubes
+ *
+ * Some operations (e.g. window_time, fill_time, aggregate_time, select_time, or crop) read the same chunks of their input
+ * cube several times, either for neighbouring output chunks or for multiple output chunks that overlap the same input chunk.
+ * Without caching, each of these reads recomputes the complete upstream chain, including all GDAL reads and warps.
+ *
+ * Chunks are identified by the unique id of the cube (see cube::uid()) and the chunk id. The total size of cached
+ * chunk buffers is limited by config::get_server_chunkcache_max(); least recently used chunks are evicted first.
+ * A limit of 0 disables the cache. Cached chunks are removed at the end of each computation (see chunk_processor::apply()),
+ * such that they do not occupy memory between computations and later computations read modified input files. Chunks are stored with the smallest element type that represents their values exactly
+ * (see chunk_data::compact()). On the first hit, a compact chunk is replaced by its FLOAT64 version, such that chunks
+ * that are read only once stay small and repeated reads of the same chunk do not copy.
+ *
+ * @note Cached chunks are shared between all readers and hence MUST NOT be modified.
+ */
+class chunk_cache {
+   public:
+    /**
+     * Summary statistics of the cache, e.g. to evaluate its effectiveness
+     */
+    struct stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t size_bytes;
+        uint64_t count;
+    };
+
+    static chunk_cache* instance() {
+        // never destroyed, cubes may release their chunks during static destruction
+        static chunk_cache* instance = new chunk_cache();
+        return instance;
+    }
+
+    /**
+     * Look up a chunk in the cache
+     * @param cube_uid unique cube identifier
+     * @param id chunk id
+     * @return the cached chunk as FLOAT64, or nullptr if the chunk is not available
+     */
+    std::shared_ptr<chunk_data> get(uint64_t cube_uid, chunkid_t id);
+
+    /**
+     * Look up a chunk in the cache and read it if it is not available
+     *
+     * If the same chunk is currently being read by another thread, this function waits for the result instead of reading
+     * the chunk again, e.g. when neighbouring output chunks of window_space are computed in parallel.
+     *
+     * @param cube_uid unique cube identifier
+     * @param id chunk id
+     * @param read function that reads the chunk on a cache miss
+     * @return the cached or read chunk, must not be modified
+     */
+    std::shared_ptr<chunk_data> get_or_read(uint64_t cube_uid, chunkid_t id, std::function<std::shared_ptr<chunk_data>()> read);
+
+    /**
+     * Add a chunk to the cache, least recently used chunks are evicted if needed
+     * @param cube_uid unique cube identifier
+     * @param id chunk id
+     * @param c chunk data, must not be modified afterwards
+     */
+    void put(uint64_t cube_uid, chunkid_t id, std::shared_ptr<chunk_data> c);
+
+    /**
+     * Remove all chunks of a given cube from the cache
+     * @param cube_uid unique cube identifier
+     */
+    void remove(uint64_t cube_uid);
+
+    /**
+     * Remove all chunks from the cache, e.g. at the end of a computation
+     *
+     * Statistics are kept, such that they summarize all computations of the process.
+     */
+    void clear();
+
+    stats get_stats();
+
+   private:
+    chunk_cache(const chunk_cache&) = delete;
+    chunk_cache(chunk_cache&&) = delete;
+    chunk_cache& operator=(const chunk_cache&) = delete;
+    chunk_cache& operator=(chunk_cache&&) = delete;
+    chunk_cache() : _entries(), _index(), _pending(), _size_bytes(0), _hits(0), _misses(0), _evictions(0), _mutex() {}
+
+    struct key_hash {
+        std::size_t operator()(const std::pair<uint64_t, chunkid_t>& k) const {
+            return std::hash<uint64_t>()((k.first << 32) ^ k.second);
+        }
+    };
+
+    typedef std::pair<uint64_t, chunkid_t> key;
+    typedef std::list<std::pair<key, std::shared_ptr<chunk_data>>> entry_list;
+
+    std::shared_ptr<chunk_data> promote(const key& k, std::shared_ptr<chunk_data> c);
+    void evict(uint64_t max_size_bytes);
+
+    entry_list _entries;  // most recently used first
+    std::unordered_map<key, entry_list::iterator, key_hash> _index;
+    std::unordered_map<key, std::shared_future<std::shared_ptr<chunk_data>>, key_hash> _pending;  // chunks currently being read
+    uint64_t _size_bytes;
+    uint64_t _hits;
+    uint64_t _misses;
+    uint64_t _evictions;
+    std::mutex _mutex;
+};
+
+}  // namespace gdalcubes
+
+#endif  // CHUNK_CACHE_H
@@ -32,6 +32,10 @@
 #include <ogr_geometry.h>
 
 #include "cube.h"
+#include "dataset_pool.h"
+#include "ncdf_cube.h"
+#include "stream_process.h"
+#include "warp.h"
 
 namespace gdalcubes {
 
@@ -46,7 +50,10 @@ config::config() : _chunk_processor(std::make_shared<chunk_processor_singlethrea
                    _swarm_curl_verbose(false),
                    _gdal_num_threads(1),
                    _gdal_use_overviews(true),
+                   _gdal_dataset_pool_max(64),
                    _streaming_dir(filesystem::get_tempdir()),
+                   _streaming_mode(streaming_mode::FILES),
+                   _chunk_order(chunk_order::AUTO),
                    _collection_format_preset_dirs() {}
 
 version_info config::get_version_info() {
@@ -76,6 +83,9 @@ void config::set_gdal_debug(bool debug) {
 
 void config::set_gdal_option(std::string key, std::string value) {
     CPLSetConfigOption(key.c_str(), value.c_str());
+    // options might affect how datasets are opened
+    gdal_dataset_pool::instance()->clear();
+    gdalwarp_client::overview_cache::instance()->clear();
 }
 
 void config::set_gdal_log(std::string logfile) {
@@ -179,6 +189,10 @@ void config::gdalcubes_init() {
 }
 
 void config::gdalcubes_cleanup() {
+    gdal_dataset_pool::instance()->clear();
+    ncdf_cube::close_files();
+    gdalwarp_client::overview_cache::instance()->clear();
+    stream_process::stop_all();
 #ifndef GDALCUBES_NO_SWARM
     curl_global_cleanup();
 #endif
@@ -186,6 +200,10 @@ void config::gdalcubes_cleanup() {
     OGRCleanupAll();
 }
 
+gdal_dataset_pool_stats config::get_gdal_dataset_pool_stats() {
+    return gdal_dataset_pool::instance()->get_stats();
+}
+
 void config::add_collection_format_preset_dir(std::string dir) {
     // only add if not exists
     for (uint16_t i = 0; i < _collection_format_preset_dirs.size(); ++i) {
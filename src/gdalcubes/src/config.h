@@ -79,6 +79,40 @@ struct version_info {
     std::string GIT_COMMIT;
 };
 
+/**
+ * @brief Usage statistics of the pool of opened GDAL datasets
+ * @see gdal_dataset_pool
+ */
+struct gdal_dataset_pool_stats {
+    uint64_t opened;        // number of GDALOpen() calls
+    uint64_t reused;        // number of requests served by an already opened dataset
+    uint64_t evicted;       // number of idle datasets closed due to the maximum number of open datasets
+    uint32_t open_idle;     // number of currently open datasets not in use
+    uint32_t open_in_use;   // number of currently open datasets in use
+};
+
+/**
+ * @brief How chunk data is exchanged with external programs in streaming operations, see stream_process
+ */
+enum class streaming_mode {
+    FILES,      // input and output as files in the streaming directory, one process per chunk
+    PIPE,       // input to stdin and output from stdout, one process per chunk
+    PERSISTENT  // like PIPE but one process per thread is kept alive and processes many chunks
+};
+
+/**
+ * @brief Order in which chunks of a cube are visited by chunk processors, see cube::chunk_sequence()
+ *
+ * Visiting chunks that share input data (e.g. the same spatial tile at subsequent times or neighbouring tiles)
+ * consecutively improves the effectiveness of the chunk cache and of GDAL's block cache.
+ */
+enum class chunk_order {
+    AUTO,        // order suggested by the cube, see cube::suggest_chunk_order()
+    ID,          // chunk ids in ascending order (time-major)
+    TIME_FIRST,  // all chunks of a spatial tile (i.e. complete time series) before the next tile
+    ZORDER       // Z-order (Morton) curve over chunk coordinates in t, y, and x
+};
+
 /**
  * @brief A singleton class to manage global configuration options
  */
@@ -112,11 +146,11 @@ class config {
 
     void set_gdal_cache_max(uint32_t size_bytes);
 
-    inline void set_server_chunkcache_max(uint32_t size_bytes) {
+    inline void set_server_chunkcache_max(uint64_t size_bytes) {
         _server_chunkcache_max = size_bytes;
     }
 
-    inline uint32_t get_server_chunkcache_max() {
+    inline uint64_t get_server_chunkcache_max() {
         return _server_chunkcache_max;
     }
 
@@ -128,6 +162,12 @@ class config {
         return _server_worker_threads_max;
     }
 
+    // Get / set the maximum number of GDAL datasets that are kept open for reuse, 0 disables reuse
+    inline uint32_t get_gdal_dataset_pool_max() { return _gdal_dataset_pool_max; }
+    inline void set_gdal_dataset_pool_max(uint32_t max_open) { _gdal_dataset_pool_max = max_open; }
+
+    gdal_dataset_pool_stats get_gdal_dataset_pool_stats();
+
     inline bool get_gdal_use_overviews() { return _gdal_use_overviews; }
     inline void set_gdal_use_overviews(bool use_overviews) { _gdal_use_overviews = use_overviews; }
 
@@ -139,6 +179,13 @@ class config {
     inline std::string get_streaming_dir() { return _streaming_dir; }
     inline void set_streaming_dir(std::string dir) { _streaming_dir = dir; }
 
+    inline streaming_mode get_streaming_mode() { return _streaming_mode; }
+    inline void set_streaming_mode(streaming_mode mode) { _streaming_mode = mode; }
+
+    // Get / set the order in which chunk processors visit chunks, chunk_order::AUTO uses the order suggested by the cube
+    inline chunk_order get_chunk_order() { return _chunk_order; }
+    inline void set_chunk_order(chunk_order order) { _chunk_order = order; }
+
     inline bool get_gdal_debug() { return _gdal_debug; }
     void set_gdal_debug(bool debug);
 
@@ -191,13 +238,16 @@ class config {
     std::shared_ptr<progress> _progress_bar;
     error_action _error_handler;
     uint32_t _gdal_cache_max;
-    uint32_t _server_chunkcache_max;
+    uint64_t _server_chunkcache_max;
     uint16_t _server_worker_threads_max;  // number of threads for parallel chunk reads
     bool _swarm_curl_verbose;
     uint16_t _gdal_num_threads;
     bool _gdal_debug;
     bool _gdal_use_overviews;
+    uint32_t _gdal_dataset_pool_max;
     std::string _streaming_dir;
+    streaming_mode _streaming_mode;
+    chunk_order _chunk_order;
     std::vector<std::string> _collection_format_preset_dirs;
 
    private:
@@ -28,12 +28,26 @@
 //#include <ogr_spatialref.h>
 
 #include <array>
+#include <cmath>
 #include <limits>
 #include <cstdint>
 #include "datetime.h"
 
 namespace gdalcubes {
 
+/**
+ * @brief Transform points in place between two spatial reference systems, using cached transformations
+ * @param srs_from source spatial reference system, as accepted by OGRSpatialReference::SetFromUserInput()
+ * @param srs_to target spatial reference system
+ * @param n number of points
+ * @param x x coordinates
+ * @param y y coordinates
+ * @param success per point success flags, may be nullptr
+ * @return false if the transformation failed for at least one point
+ * @note implemented in warp.cpp
+ */
+bool transform_points(const std::string &srs_from, const std::string &srs_to, uint32_t n, double *x, double *y, int *success = nullptr);
+
 template <typename Ta>
 struct bounds_2d {
     Ta left, bottom, top, right;
@@ -72,45 +86,63 @@ struct bounds_2d {
         return out;
     }
 
+    /**
+     * @brief Transform the bounding box to another spatial reference system
+     *
+     * Points along all four edges (not only the corners) are transformed, such that the result contains curved
+     * edges in the target system. Transformations are cached per pair of spatial reference systems.
+     * @param srs_from spatial reference system of the bounding box
+     * @param srs_to target spatial reference system
+     * @return the transformed bounding box, which is also assigned to this object
+     */
     bounds_2d<Ta> transform(std::string srs_from, std::string srs_to) {
         if (srs_from == srs_to) {
             return *this;
         }
-        OGRSpatialReference srs_in;
-        OGRSpatialReference srs_out;
-        srs_in.SetFromUserInput(srs_from.c_str());
-        srs_out.SetFromUserInput(srs_to.c_str());
-
-        if (srs_in.IsSame(&srs_out)) {
-            return *this;
-        }
-
-        OGRCoordinateTransformation* coord_transform = OGRCreateCoordinateTransformation(&srs_in, &srs_out);
 
-        Ta x[4] = {left, left, right, right};
-        Ta y[4] = {top, bottom, top, bottom};
-
-        if (coord_transform == NULL || !coord_transform->Transform(4, x, y)) {
-            throw std::string("ERROR: coordinate transformation failed (from " + srs_from + " to " + srs_to + ").");
+        // number of segments per edge
+        const uint16_t nseg = 20;
+        const uint16_t n = 4 * nseg;
+        double x[n];
+        double y[n];
+        int success[n];
+        for (uint16_t i = 0; i < nseg; ++i) {
+            double f = (double)i / (double)nseg;
+            // top (left to right), right (top to bottom), bottom (right to left), left (bottom to top)
+            x[i] = left + f * (right - left);
+            y[i] = top;
+            x[nseg + i] = right;
+            y[nseg + i] = top - f * (top - bottom);
+            x[2 * nseg + i] = right - f * (right - left);
+            y[2 * nseg + i] = bottom;
+            x[3 * nseg + i] = left;
+            y[3 * nseg + i] = bottom + f * (top - bottom);
         }
 
-        Ta xmin = std::numeric_limits<Ta>::is_integer ? std::numeric_limits<Ta>::max() : std::numeric_limits<Ta>::max();
-        Ta ymin = std::numeric_limits<Ta>::is_integer ? std::numeric_limits<Ta>::max() : std::numeric_limits<Ta>::max();
-        Ta xmax = std::numeric_limits<Ta>::is_integer ? std::numeric_limits<Ta>::min() : -std::numeric_limits<Ta>::max();
-        Ta ymax = std::numeric_limits<Ta>::is_integer ? std::numeric_limits<Ta>::min() : -std::numeric_limits<Ta>::max();
-        for (uint8_t k = 0; k < 4; ++k) {
+        transform_points(srs_from, srs_to, n, x, y, success);
+
+        double xmin = std::numeric_limits<double>::max();
+        double ymin = std::numeric_limits<double>::max();
+        double xmax = -std::numeric_limits<double>::max();
+        double ymax = -std::numeric_limits<double>::max();
+        bool any = false;
+        for (uint16_t k = 0; k < n; ++k) {
+            // ignore points outside of the area of use of the target system
+            if (!success[k] || std::isnan(x[k]) || std::isnan(y[k])) continue;
+            any = true;
             if (x[k] < xmin) xmin = x[k];
             if (y[k] < ymin) ymin = y[k];
             if (x[k] > xmax) xmax = x[k];
             if (y[k] > ymax) ymax = y[k];
         }
+        if (!any) {
+            throw std::string("ERROR: coordinate transformation failed (from " + srs_from + " to " + srs_to + ").");
+        }
 
-        left = xmin;
-        right = xmax;
-        top = ymax;
-        bottom = ymin;
-
-        OCTDestroyCoordinateTransformation(coord_transform);
+        left = (Ta)xmin;
+        right = (Ta)xmax;
+        top = (Ta)ymax;
+        bottom = (Ta)ymin;
 
         return *this;
     }
@@ -56,7 +56,7 @@ std::shared_ptr<chunk_data> crop_cube::read_chunk(chunkid_t id) {
         for (uint16_t ch_y = input_chunk_coords_low[1]; ch_y <= input_chunk_coords_high[1]; ++ch_y) {
             for (uint16_t ch_x = input_chunk_coords_low[2]; ch_x <= input_chunk_coords_high[2]; ++ch_x) {
                 chunkid_t input_chunk_id = _in_cube->chunk_id_from_coords({ch_t, ch_y, ch_x});
-                std::shared_ptr<chunk_data> in_chunk = _in_cube->read_chunk(input_chunk_id);
+                std::shared_ptr<chunk_data> in_chunk = _in_cube->read_chunk_cached(input_chunk_id);
 
 
                 // propagate chunk status
@@ -29,12 +29,24 @@ SOFTWARE.
 #include <netcdf.h>
 
 #include <algorithm>  // std::transform
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <limits>
+#include <list>
 #include <thread>
 #include <cstring>
 
 #include "build_info.h"
+#include "chunk_cache.h"
+#include "dataset_pool.h"
 #include "filesystem.h"
+#include "image_collection.h"
+#include "ncdf_cube.h"
+#include "pack_kernels.h"
+#include "stream_process.h"
+#include "warp.h"
 
 #if defined(R_PACKAGE) && defined(__sun) && defined(__SVR4)
 #define USE_NCDF4 0
@@ -119,9 +131,48 @@ packed_export packed_export::make_uint8(std::vector<double> scale, std::vector<d
 
 
 
+// conversion kernels between FLOAT64 and compact chunk buffers, na is the value representing NAN
+template <typename T>
+static void encode_values(const double *in, T *out, uint64_t n, T na) {
+    for (uint64_t i = 0; i < n; ++i) {
+        out[i] = std::isnan(in[i]) ? na : static_cast<T>(in[i]);
+    }
+}
+
+template <typename T>
+static void decode_values(const T *in, double *out, uint64_t n, T na) {
+    for (uint64_t i = 0; i < n; ++i) {
+        out[i] = (in[i] == na) ? NAN : static_cast<double>(in[i]);
+    }
+}
+
+template <typename T>
+static bool all_na(const T *in, uint64_t n, T na) {
+    for (uint64_t i = 0; i < n; ++i) {
+        if (in[i] != na) return false;
+    }
+    return true;
+}
+
 bool chunk_data::all_nan() {
     if (empty()) return true;
-    for (uint32_t i=0; i< _size[0] * _size[1] * _size[2] * _size[3]; ++i) {
+    uint64_t n = uint64_t(_size[0]) * _size[1] * _size[2] * _size[3];
+    switch (_type) {
+        case value_type::UINT8:
+            return all_na((uint8_t *)_buf, n, std::numeric_limits<uint8_t>::max());
+        case value_type::UINT16:
+            return all_na((uint16_t *)_buf, n, std::numeric_limits<uint16_t>::max());
+        case value_type::INT16:
+            return all_na((int16_t *)_buf, n, std::numeric_limits<int16_t>::min());
+        case value_type::FLOAT32:
+            for (uint64_t i = 0; i < n; ++i) {
+                if (!std::isnan(((float *)_buf)[i])) return false;
+            }
+            return true;
+        default:
+            break;
+    }
+    for (uint64_t i = 0; i < n; ++i) {
         if (!std::isnan(((double*)_buf)[i])) {
             return false;
         }
@@ -129,12 +180,104 @@ bool chunk_data::all_nan() {
     return true;
 }
 
+std::shared_ptr<chunk_data> chunk_data::compact() {
+    if (empty() || _type != value_type::FLOAT64) return nullptr;
+    uint64_t n = uint64_t(_size[0]) * _size[1] * _size[2] * _size[3];
+    const double *in = (const double *)_buf;
+
+    // find the smallest type that represents all values exactly, NAN is mapped to a reserved value
+    bool integral = true;
+    bool float_exact = true;
+    double vmin = std::numeric_limits<double>::infinity();
+    double vmax = -std::numeric_limits<double>::infinity();
+    for (uint64_t i = 0; i < n; ++i) {
+        double v = in[i];
+        if (std::isnan(v)) continue;
+        if (v < vmin) vmin = v;
+        if (v > vmax) vmax = v;
+        if (integral && (std::isinf(v) || v != std::trunc(v))) integral = false;
+        if (float_exact && !std::isinf(v) && (std::fabs(v) > std::numeric_limits<float>::max() || double(float(v)) != v)) float_exact = false;
+        if (!integral && !float_exact) return nullptr;
+    }
 
+    value_type t;
+    if (integral && vmin >= 0 && vmax < std::numeric_limits<uint8_t>::max()) {
+        t = value_type::UINT8;
+    } else if (integral && vmin >= 0 && vmax < std::numeric_limits<uint16_t>::max()) {
+        t = value_type::UINT16;
+    } else if (integral && vmin > std::numeric_limits<int16_t>::min() && vmax <= std::numeric_limits<int16_t>::max()) {
+        t = value_type::INT16;
+    } else if (float_exact) {
+        t = value_type::FLOAT32;
+    } else {
+        return nullptr;
+    }
 
+    std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
+    out->size(_size);
+    out->set_status(_status);
+    out->_type = t;
+    out->buf(std::malloc(n * value_size(t)));
+    switch (t) {
+        case value_type::UINT8:
+            encode_values(in, (uint8_t *)out->buf(), n, std::numeric_limits<uint8_t>::max());
+            break;
+        case value_type::UINT16:
+            encode_values(in, (uint16_t *)out->buf(), n, std::numeric_limits<uint16_t>::max());
+            break;
+        case value_type::INT16:
+            encode_values(in, (int16_t *)out->buf(), n, std::numeric_limits<int16_t>::min());
+            break;
+        default:
+            encode_values(in, (float *)out->buf(), n, std::numeric_limits<float>::quiet_NaN());
+            break;
+    }
+    return out;
+}
 
+std::shared_ptr<chunk_data> chunk_data::promote() {
+    std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
+    out->size(_size);
+    out->set_status(_status);
+    if (empty()) return out;
+    uint64_t n = uint64_t(_size[0]) * _size[1] * _size[2] * _size[3];
+    out->buf(std::malloc(n * sizeof(double)));
+    double *o = (double *)out->buf();
+    switch (_type) {
+        case value_type::UINT8:
+            decode_values((const uint8_t *)_buf, o, n, std::numeric_limits<uint8_t>::max());
+            break;
+        case value_type::UINT16:
+            decode_values((const uint16_t *)_buf, o, n, std::numeric_limits<uint16_t>::max());
+            break;
+        case value_type::INT16:
+            decode_values((const int16_t *)_buf, o, n, std::numeric_limits<int16_t>::min());
+            break;
+        case value_type::FLOAT32:
+            decode_values((const float *)_buf, o, n, std::numeric_limits<float>::quiet_NaN());
+            break;
+        default:
+            std::memcpy(o, _buf, n * sizeof(double));
+            break;
+    }
+    return out;
+}
 
+uint64_t cube::make_uid() {
+    static std::atomic<uint64_t> next_uid(0);
+    return next_uid++;
+}
 
+cube::~cube() {
+    chunk_cache::instance()->remove(_uid);
+}
 
+std::shared_ptr<chunk_data> cube::read_chunk_cached(chunkid_t id) {
+    if (config::instance()->get_server_chunkcache_max() == 0) {
+        return read_chunk(id);
+    }
+    return chunk_cache::instance()->get_or_read(_uid, id, [this, id]() { return read_chunk(id); });
+}
 
 chunkid_t cube::find_chunk_that_contains(coords_st p) const {
     uint32_t cumprod = 1;
@@ -262,6 +405,48 @@ chunk_coordinate_tyx cube::chunk_coords_from_id(chunkid_t id) {
     return out;
 }
 
+std::vector<chunkid_t> cube::chunk_sequence(chunk_order order) {
+    if (order == chunk_order::AUTO) {
+        order = suggest_chunk_order();
+    }
+    uint32_t nchunks = count_chunks();
+    std::vector<chunkid_t> out;
+    out.reserve(nchunks);
+
+    if (order == chunk_order::TIME_FIRST) {
+        for (uint32_t cy = 0; cy < count_chunks_y(); ++cy) {
+            for (uint32_t cx = 0; cx < count_chunks_x(); ++cx) {
+                for (uint32_t ct = 0; ct < count_chunks_t(); ++ct) {
+                    out.push_back(chunk_id_from_coords({ct, cy, cx}));
+                }
+            }
+        }
+    } else if (order == chunk_order::ZORDER) {
+        // interleave bits of chunk coordinates, 21 bits per dimension are more than enough
+        std::vector<std::pair<uint64_t, chunkid_t>> keys;
+        keys.reserve(nchunks);
+        for (chunkid_t i = 0; i < nchunks; ++i) {
+            chunk_coordinate_tyx c = chunk_coords_from_id(i);
+            uint64_t key = 0;
+            for (uint16_t ib = 0; ib < 21; ++ib) {
+                key |= (uint64_t((c[2] >> ib) & 1) << (3 * ib)) |
+                       (uint64_t((c[1] >> ib) & 1) << (3 * ib + 1)) |
+                       (uint64_t((c[0] >> ib) & 1) << (3 * ib + 2));
+            }
+            keys.push_back(std::make_pair(key, i));
+        }
+        std::sort(keys.begin(), keys.end());
+        for (auto it = keys.begin(); it != keys.end(); ++it) {
+            out.push_back(it->second);
+        }
+    } else {
+        for (chunkid_t i = 0; i < nchunks; ++i) {
+            out.push_back(i);
+        }
+    }
+    return out;
+}
+
 
 
 bounds_st cube::bounds_from_chunk(chunkid_t id) const {
@@ -289,6 +474,132 @@ bounds_st cube::bounds_from_chunk(chunkid_t id) const {
 
 
 
+namespace {
+
+/**
+ * Part of one time slice of a data cube that is written to a GeoTIFF file
+ */
+struct tif_block {
+    uint32_t x0, y0, nx, ny;
+    const void *data;          // band sequential pixel values
+    GSpacing band_space;       // bytes between bands in data
+    std::vector<uint8_t> buf;  // owns data of packed blocks
+    std::shared_ptr<chunk_data> chunk;  // owns data of unpacked blocks
+};
+
+/**
+ * Writes blocks to a set of GeoTIFF files from a few background threads
+ *
+ * Each file is assigned to exactly one writer thread, which opens it on first use and keeps it open
+ * until the end of the job (up to a maximum number of open files per thread), such that partially written
+ * tiles remain in GDAL's block cache instead of being flushed and reread for every chunk. Compute threads only
+ * enqueue blocks and wait only if too many blocks are pending.
+ */
+class tif_writer {
+   public:
+    tif_writer(std::vector<std::string> files, GDALDataType type, uint16_t nthreads, uint32_t max_pending, uint32_t max_open)
+        : _files(files), _type(type), _queues(nthreads), _pending(0), _max_pending(max_pending), _max_open(max_open), _done(false) {
+        for (uint16_t i = 0; i < nthreads; ++i) {
+            _threads.push_back(std::thread(&tif_writer::run, this, i));
+        }
+    }
+
+    ~tif_writer() {
+        finish();
+    }
+
+    void push(uint32_t file_index, std::shared_ptr<tif_block> b) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv_pending.wait(lock, [this] { return _pending < _max_pending; });
+            ++_pending;
+            _queues[file_index % _queues.size()].push_back(std::make_pair(file_index, b));
+        }
+        _cv.notify_all();
+    }
+
+    /**
+     * Write all pending blocks, close all files, and stop writer threads
+     */
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _done = true;
+        }
+        _cv.notify_all();
+        for (uint16_t i = 0; i < _threads.size(); ++i) {
+            _threads[i].join();
+        }
+        _threads.clear();
+    }
+
+   private:
+    void run(uint16_t iw) {
+        std::map<uint32_t, GDALDataset *> open;
+        std::list<uint32_t> lru;  // most recently used first
+        while (true) {
+            std::pair<uint32_t, std::shared_ptr<tif_block>> j;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cv.wait(lock, [this, iw] { return _done || !_queues[iw].empty(); });
+                if (_queues[iw].empty()) break;
+                j = _queues[iw].front();
+                _queues[iw].pop_front();
+            }
+
+            GDALDataset *ds = nullptr;
+            auto it = open.find(j.first);
+            if (it != open.end()) {
+                ds = it->second;
+                lru.remove(j.first);
+            } else {
+                if (open.size() >= _max_open) {
+                    GDALClose((GDALDatasetH)open[lru.back()]);
+                    open.erase(lru.back());
+                    lru.pop_back();
+                }
+                ds = (GDALDataset *)GDALOpen(_files[j.first].c_str(), GA_Update);
+                if (ds) open[j.first] = ds;
+            }
+            if (!ds) {
+                GCBS_WARN("GDAL failed to open " + _files[j.first]);
+            } else {
+                lru.push_front(j.first);
+                std::shared_ptr<tif_block> b = j.second;
+                CPLErr res = ds->RasterIO(GF_Write, b->x0, b->y0, b->nx, b->ny, const_cast<void *>(b->data), b->nx, b->ny, _type,
+                                          ds->GetRasterCount(), nullptr, 0, 0, b->band_space, nullptr);
+                if (res != CE_None) {
+                    GCBS_WARN("RasterIO (write) failed for " + _files[j.first]);
+                }
+            }
+            j.second.reset();
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                --_pending;
+            }
+            _cv_pending.notify_all();
+        }
+        for (auto it = open.begin(); it != open.end(); ++it) {
+            GDALClose((GDALDatasetH)it->second);
+        }
+    }
+
+    std::vector<std::string> _files;
+    GDALDataType _type;
+    std::vector<std::deque<std::pair<uint32_t, std::shared_ptr<tif_block>>>> _queues;  // one queue per writer thread
+    std::vector<std::thread> _threads;
+    uint32_t _pending;
+    uint32_t _max_pending;
+    uint32_t _max_open;
+    bool _done;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::condition_variable _cv_pending;
+};
+
+}  // namespace
+
 void cube::write_tif_collection(std::string dir, std::string prefix,
                                 bool overviews, bool cog,
                                 std::map<std::string, std::string> creation_options,
@@ -363,9 +674,6 @@ void cube::write_tif_collection(std::string dir, std::string prefix,
     std::shared_ptr<progress> prg = config::instance()->get_default_progress_bar()->get();
     prg->set(0);  // explicitly set to zero to show progress bar immediately
 
-    // avoid parallel RasterIO calls writing to the same file
-    std::map<uint32_t, std::mutex> mtx;  // time_slice_index -> mutex
-
     CPLStringList out_co;
     out_co.AddNameValue("TILED", "YES");
     if (creation_options.find("BLOCKXSIZE") != creation_options.end()) {
@@ -443,75 +751,71 @@ void cube::write_tif_collection(std::string dir, std::string prefix,
         GDALClose((GDALDatasetH)gdal_out);
     }
 
-    std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f = [this, dir, prg, &mtx, &prefix, &packing, cog, overviews](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
-        if (!dat->empty()) {
-            for (uint32_t it = 0; it < dat->size()[1]; ++it) {
-                uint32_t cur_t_index = chunk_limits(id).low[0] + it;
-                std::string name = cog ? filesystem::join(dir, prefix + st_reference()->datetime_at_index(cur_t_index).to_string() + "_temp.tif") : filesystem::join(dir, prefix + st_reference()->datetime_at_index(cur_t_index).to_string() + ".tif");
-
-                mtx[cur_t_index].lock();
-                GDALDataset *gdal_out = (GDALDataset *)GDALOpen(name.c_str(), GA_Update);
-                if (!gdal_out) {
-                    GCBS_WARN("GDAL failed to open " + name);
-                    mtx[cur_t_index].unlock();
-                    continue;
-                }
-
-                // apply packing
-                if (packing.type != packed_export::packing_type::PACK_NONE) {
-                    for (uint16_t ib = 0; ib < size_bands(); ++ib) {
-                        double cur_scale;
-                        double cur_offset;
-                        double cur_nodata;
-                        if (packing.scale.size() == size_bands()) {
-                            cur_scale = packing.scale[ib];
-                            cur_offset = packing.offset[ib];
-                            cur_nodata = packing.nodata[ib];
-                        } else {
-                            cur_scale = packing.scale[0];
-                            cur_offset = packing.offset[0];
-                            cur_nodata = packing.nodata[0];
-                        }
+    std::vector<std::string> files;
+    for (uint32_t it = 0; it < size_t(); ++it) {
+        files.push_back(cog ? filesystem::join(dir, prefix + st_reference()->datetime_at_index(it).to_string() + "_temp.tif") : filesystem::join(dir, prefix + st_reference()->datetime_at_index(it).to_string() + ".tif"));
+    }
+    uint16_t nwriters = std::max(1u, std::min(std::thread::hardware_concurrency(), (unsigned int)size_t()));
+    tif_writer writer(files, ot, nwriters, 4 * nwriters + 16, std::max(1, 256 / nwriters));
 
-                        /*
-                         * If band of cube already has scale + offset, we do not apply this before.
-                         * As a consequence, provided scale and offset values refer to actual data values
-                         * but ignore band metadata. The following commented code would apply the
-                         * unpacking before
-                         */
-                        /*
-                        if (bands().get(ib).scale != 1 || bands().get(ib).offset != 0) {
-                            for (uint32_t i = 0; i < dat->size()[2] * dat->size()[3]; ++i) {
-                                double &v = ((double *)(dat->buf()))[ib * dat->size()[1] * dat->size()[2] * dat->size()[3] +
-                                                                     it * dat->size()[2] * dat->size()[3]  + i];
-                                v = v * bands().get(ib).scale + bands().get(ib).offset;
-                            }
-                        } */
-
-                        for (uint32_t i = 0; i < dat->size()[2] * dat->size()[3]; ++i) {
-                            double &v = ((double *)(dat->buf()))[ib * dat->size()[1] * dat->size()[2] * dat->size()[3] +
-                                                                 it * dat->size()[2] * dat->size()[3] + i];
-                            if (std::isnan(v)) {
-                                v = cur_nodata;
-                            } else {
-                                v = std::round((v - cur_offset) / cur_scale);  // use std::round to avoid truncation bias
-                            }
+    std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f = [this, prg, &writer, &packing, ot, overviews](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
+        if (!dat->empty()) {
+            bounds_nd<uint32_t, 3> climits = chunk_limits(id);
+            const std::size_t nb = dat->size()[0];
+            const std::size_t nt = dat->size()[1];
+            const std::size_t npix = std::size_t(dat->size()[2]) * std::size_t(dat->size()[3]);
+            const std::size_t tsize = GDALGetDataTypeSizeBytes(ot);
+
+            for (uint32_t it = 0; it < nt; ++it) {
+                std::shared_ptr<tif_block> b = std::make_shared<tif_block>();
+                b->x0 = climits.low[2];
+                b->y0 = climits.low[1];
+                b->nx = dat->size()[3];
+                b->ny = dat->size()[2];
+
+                if (packing.type == packed_export::packing_type::PACK_NONE) {
+                    // no copy, bands of a time slice are nt * npix values apart
+                    b->chunk = dat;
+                    b->data = ((const double *)dat->buf()) + it * npix;
+                    b->band_space = nt * npix * sizeof(double);
+                } else {
+                    /*
+                     * If band of cube already has scale + offset, we do not apply this before.
+                     * As a consequence, provided scale and offset values refer to actual data values
+                     * but ignore band metadata.
+                     */
+                    b->buf.resize(nb * npix * tsize);
+                    for (uint16_t ib = 0; ib < nb; ++ib) {
+                        std::size_t ip = (packing.scale.size() == size_bands()) ? ib : 0;
+                        const double *src = ((const double *)dat->buf()) + (ib * nt + it) * npix;
+                        void *dst = b->buf.data() + ib * npix * tsize;
+                        switch (ot) {
+                            case GDT_Byte:
+                                pack_kernels::pack(src, (uint8_t *)dst, npix, packing.scale[ip], packing.offset[ip], packing.nodata[ip]);
+                                break;
+                            case GDT_UInt16:
+                                pack_kernels::pack(src, (uint16_t *)dst, npix, packing.scale[ip], packing.offset[ip], packing.nodata[ip]);
+                                break;
+                            case GDT_UInt32:
+                                pack_kernels::pack(src, (uint32_t *)dst, npix, packing.scale[ip], packing.offset[ip], packing.nodata[ip]);
+                                break;
+                            case GDT_Int16:
+                                pack_kernels::pack(src, (int16_t *)dst, npix, packing.scale[ip], packing.offset[ip], packing.nodata[ip]);
+                                break;
+                            case GDT_Int32:
+                                pack_kernels::pack(src, (int32_t *)dst, npix, packing.scale[ip], packing.offset[ip], packing.nodata[ip]);
+                                break;
+                            case GDT_Float32:
+                                pack_kernels::pack(src, (float *)dst, npix, packing.scale[ip], packing.offset[ip], packing.nodata[ip]);
+                                break;
+                            default:
+                                pack_kernels::pack(src, (double *)dst, npix, packing.scale[ip], packing.offset[ip], packing.nodata[ip]);
                         }
                     }
-                }  // if packing
-
-                for (uint16_t ib = 0; ib < size_bands(); ++ib) {
-                    CPLErr res = gdal_out->GetRasterBand(ib + 1)->RasterIO(GF_Write, chunk_limits(id).low[2], chunk_limits(id).low[1], dat->size()[3], dat->size()[2],
-                                                                           ((double *)dat->buf()) + (ib * dat->size()[1] * dat->size()[2] * dat->size()[3] + it * dat->size()[2] * dat->size()[3]),
-                                                                           dat->size()[3], dat->size()[2], GDT_Float64, 0, 0, NULL);
-                    if (res != CE_None) {
-                        GCBS_WARN("RasterIO (write) failed for " + name);
-                        break;
-                    }
+                    b->data = b->buf.data();
+                    b->band_space = npix * tsize;
                 }
-
-                GDALClose(gdal_out);
-                mtx[cur_t_index].unlock();
+                writer.push(climits.low[0] + it, b);
             }
         }
 
@@ -523,6 +827,7 @@ void cube::write_tif_collection(std::string dir, std::string prefix,
     };
 
     p->apply(shared_from_this(), f);
+    writer.finish();
 
     // build overviews and convert to COG (with IFDs of overviews at the beginning of the file)
     // TODO: use multiple threads
@@ -748,6 +1053,8 @@ void cube::write_netcdf_file(std::string path, uint8_t compression_level, bool w
 
     int ncout;
 
+    // other threads may read from netCDF input cubes, all nc_* calls must be serialized
+    std::unique_lock<std::mutex> nc_lock(ncdf_cube::nc_mutex());
 #if USE_NCDF4 == 1
     nc_create(op.c_str(), NC_NETCDF4, &ncout);
 #else
@@ -948,6 +1255,7 @@ void cube::write_netcdf_file(std::string path, uint8_t compression_level, bool w
         nc_put_var(ncout, v_ybnds, (void *)dim_y_bnds);
         nc_put_var(ncout, v_xbnds, (void *)dim_x_bnds);
     }
+    nc_lock.unlock();
 
     if (dim_t) std::free(dim_t);
     if (dim_y) std::free(dim_y);
@@ -966,11 +1274,13 @@ void cube::write_netcdf_file(std::string path, uint8_t compression_level, bool w
         int nc_chunk_status = (int)dat->status();
         std::size_t nc_chunk_id = std::size_t(id);
         m.lock();
-        nc_put_var1_int(ncout, v_chunkstatus, &nc_chunk_id, &nc_chunk_status);
         if (dat->status() != chunk_data::chunk_status::OK) {
             chunk_error_count++;
         }
         m.unlock();
+        ncdf_cube::nc_mutex().lock();
+        nc_put_var1_int(ncout, v_chunkstatus, &nc_chunk_id, &nc_chunk_status);
+        ncdf_cube::nc_mutex().unlock();
         if (!dat->empty()) {
             chunk_size_btyx csize = dat->size();
             bounds_nd<uint32_t, 3> climits = chunk_limits(id);
@@ -1006,93 +1316,41 @@ void cube::write_netcdf_file(std::string path, uint8_t compression_level, bool w
                       }
                   } */
 
-                    uint8_t *packedbuf = nullptr;
+                    std::size_t n = std::size_t(csize[1]) * std::size_t(csize[2]) * std::size_t(csize[3]);
+                    const double *bandbuf = ((const double *)(dat->buf())) + i * n;
+                    void *packedbuf = nullptr;
 
+                    // pack into a separate buffer, dat might be shared with the chunk cache and must not be modified
                     if (packing.type == packed_export::packing_type::PACK_UINT8) {
-                        packedbuf = (uint8_t *)std::malloc(dat->size()[1] * dat->size()[2] * dat->size()[3] * sizeof(uint8_t));
-                        for (uint32_t iv = 0; iv < dat->size()[1] * dat->size()[2] * dat->size()[3]; ++iv) {
-                            double &v = ((double *)(dat->buf()))[i * dat->size()[1] * dat->size()[2] * dat->size()[3] + iv];
-                            if (std::isnan(v)) {
-                                v = cur_nodata;
-                            } else {
-                                v = std::round((v - cur_offset) / cur_scale);  // use std::round to avoid truncation bias
-                            }
-                            ((uint8_t *)(packedbuf))[iv] = v;
-                        }
-                        m.lock();
-                        nc_put_vara(ncout, v_bands[i], startp, countp, (void *)(packedbuf));
-                        m.unlock();
+                        packedbuf = std::malloc(n * sizeof(uint8_t));
+                        pack_kernels::pack(bandbuf, (uint8_t *)packedbuf, n, cur_scale, cur_offset, cur_nodata);
                     } else if (packing.type == packed_export::packing_type::PACK_UINT16) {
-                        packedbuf = (uint8_t *)std::malloc(dat->size()[1] * dat->size()[2] * dat->size()[3] * sizeof(uint16_t));
-                        for (uint32_t iv = 0; iv < dat->size()[1] * dat->size()[2] * dat->size()[3]; ++iv) {
-                            double &v = ((double *)(dat->buf()))[i * dat->size()[1] * dat->size()[2] * dat->size()[3] + iv];
-                            if (std::isnan(v)) {
-                                v = cur_nodata;
-                            } else {
-                                v = std::round((v - cur_offset) / cur_scale);  // use std::round to avoid truncation bias
-                            }
-                            ((uint16_t *)(packedbuf))[iv] = v;
-                        }
-                        m.lock();
-                        nc_put_vara(ncout, v_bands[i], startp, countp, (void *)(packedbuf));
-                        m.unlock();
+                        packedbuf = std::malloc(n * sizeof(uint16_t));
+                        pack_kernels::pack(bandbuf, (uint16_t *)packedbuf, n, cur_scale, cur_offset, cur_nodata);
                     } else if (packing.type == packed_export::packing_type::PACK_UINT32) {
-                        packedbuf = (uint8_t *)std::malloc(dat->size()[1] * dat->size()[2] * dat->size()[3] * sizeof(uint32_t));
-                        for (uint32_t iv = 0; iv < dat->size()[1] * dat->size()[2] * dat->size()[3]; ++iv) {
-                            double &v = ((double *)(dat->buf()))[i * dat->size()[1] * dat->size()[2] * dat->size()[3] + iv];
-                            if (std::isnan(v)) {
-                                v = cur_nodata;
-                            } else {
-                                v = std::round((v - cur_offset) / cur_scale);  // use std::round to avoid truncation bias
-                            }
-                            ((uint32_t *)(packedbuf))[iv] = v;
-                        }
-                        m.lock();
-                        nc_put_vara(ncout, v_bands[i], startp, countp, (void *)(packedbuf));
-                        m.unlock();
+                        packedbuf = std::malloc(n * sizeof(uint32_t));
+                        pack_kernels::pack(bandbuf, (uint32_t *)packedbuf, n, cur_scale, cur_offset, cur_nodata);
                     } else if (packing.type == packed_export::packing_type::PACK_INT16) {
-                        packedbuf = (uint8_t *)std::malloc(dat->size()[1] * dat->size()[2] * dat->size()[3] * sizeof(int16_t));
-                        for (uint32_t iv = 0; iv < dat->size()[1] * dat->size()[2] * dat->size()[3]; ++iv) {
-                            double &v = ((double *)(dat->buf()))[i * dat->size()[1] * dat->size()[2] * dat->size()[3] + iv];
-                            if (std::isnan(v)) {
-                                v = cur_nodata;
-                            } else {
-                                v = std::round((v - cur_offset) / cur_scale);  // use std::round to avoid truncation bias
-                            }
-                            ((int16_t *)(packedbuf))[iv] = v;
-                        }
-                        m.lock();
-                        nc_put_vara(ncout, v_bands[i], startp, countp, (void *)(packedbuf));
-                        m.unlock();
+                        packedbuf = std::malloc(n * sizeof(int16_t));
+                        pack_kernels::pack(bandbuf, (int16_t *)packedbuf, n, cur_scale, cur_offset, cur_nodata);
                     } else if (packing.type == packed_export::packing_type::PACK_INT32) {
-                        packedbuf = (uint8_t *)std::malloc(dat->size()[1] * dat->size()[2] * dat->size()[3] * sizeof(int32_t));
-                        for (uint32_t iv = 0; iv < dat->size()[1] * dat->size()[2] * dat->size()[3]; ++iv) {
-                            double &v = ((double *)(dat->buf()))[i * dat->size()[1] * dat->size()[2] * dat->size()[3] + iv];
-                            if (std::isnan(v)) {
-                                v = cur_nodata;
-                            } else {
-                                v = std::round((v - cur_offset) / cur_scale);  // use std::round to avoid truncation bias
-                            }
-                            ((int32_t *)(packedbuf))[iv] = v;
-                        }
-                        m.lock();
-                        nc_put_vara(ncout, v_bands[i], startp, countp, (void *)(packedbuf));
-                        m.unlock();
+                        packedbuf = std::malloc(n * sizeof(int32_t));
+                        pack_kernels::pack(bandbuf, (int32_t *)packedbuf, n, cur_scale, cur_offset, cur_nodata);
                     } else if (packing.type == packed_export::packing_type::PACK_FLOAT32) {
-                        packedbuf = (uint8_t *)std::malloc(dat->size()[1] * dat->size()[2] * dat->size()[3] * sizeof(float));
-                        for (uint32_t iv = 0; iv < dat->size()[1] * dat->size()[2] * dat->size()[3]; ++iv) {
-                            double &v = ((double *)(dat->buf()))[i * dat->size()[1] * dat->size()[2] * dat->size()[3] + iv];
-                            ((float *)(packedbuf))[iv] = v;
-                        }
-                        m.lock();
-                        nc_put_vara(ncout, v_bands[i], startp, countp, (void *)(packedbuf));
-                        m.unlock();
+                        // scale = 1, offset = 0, and nodata = NAN for float32 (see above)
+                        packedbuf = std::malloc(n * sizeof(float));
+                        pack_kernels::pack(bandbuf, (float *)packedbuf, n, cur_scale, cur_offset, cur_nodata);
+                    }
+                    if (packedbuf) {
+                        ncdf_cube::nc_mutex().lock();
+                        nc_put_vara(ncout, v_bands[i], startp, countp, packedbuf);
+                        ncdf_cube::nc_mutex().unlock();
                     }
                     if (packedbuf) std::free(packedbuf);
                 } else {
-                    m.lock();
+                    ncdf_cube::nc_mutex().lock();
                     nc_put_vara(ncout, v_bands[i], startp, countp, (void *)(((double *)dat->buf()) + (int)i * (int)csize[1] * (int)csize[2] * (int)csize[3]));
-                    m.unlock();
+                    ncdf_cube::nc_mutex().unlock();
                 }
             }
         }
@@ -1100,7 +1358,9 @@ void cube::write_netcdf_file(std::string path, uint8_t compression_level, bool w
     };
 
     p->apply(shared_from_this(), f);
+    nc_lock.lock();
     nc_close(ncout);
+    nc_lock.unlock();
     prg->finalize();
 
 
@@ -1619,28 +1879,43 @@ void cube::write_chunks_netcdf(std::string dir, std::string name, uint8_t compre
 void chunk_processor_singlethread::apply(std::shared_ptr<cube> c,
                                          std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f) {
     std::mutex mutex;
-    uint32_t nchunks = c->count_chunks();
-    for (uint32_t i = 0; i < nchunks; ++i) {
-        std::shared_ptr<chunk_data> dat = c->read_chunk(i);
-        f(i, dat, mutex);
+    // pooled datasets are kept open across computations unless their files have been modified in between
+    gdal_dataset_pool::instance()->revalidate();
+    image_collection::next_query_batch();
+    std::vector<chunkid_t> chunks = c->chunk_sequence(config::instance()->get_chunk_order());
+    for (uint32_t i = 0; i < chunks.size(); ++i) {
+        std::shared_ptr<chunk_data> dat = c->read_chunk(chunks[i]);
+        f(chunks[i], dat, mutex);
     }
+    ncdf_cube::close_files();
+    stream_process::stop_all();
+    chunk_cache::instance()->clear();
 }
 
 void chunk_processor_multithread::apply(std::shared_ptr<cube> c,
                                         std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f) {
     std::mutex mutex;
     std::vector<std::thread> workers;
+    // pooled datasets are kept open across computations unless their files have been modified in between
+    gdal_dataset_pool::instance()->revalidate();
+    image_collection::next_query_batch();
+    // Chunks are assigned dynamically, i.e. each thread fetches the next unprocessed chunk as soon as it is idle.
+    // Compared to a static assignment (thread i processes chunks i, i + nthreads, ...), this avoids idle threads if
+    // chunk costs vary a lot, e.g. due to different numbers of images per chunk or empty chunks.
+    std::atomic<uint32_t> next_chunk(0);
+    std::vector<chunkid_t> chunks = c->chunk_sequence(config::instance()->get_chunk_order());
+    uint32_t nchunks = chunks.size();
     for (uint16_t it = 0; it < _nthreads; ++it) {
-        workers.push_back(std::thread([this, &c, f, it, &mutex](void) {
-            for (uint32_t i = it; i < c->count_chunks(); i += _nthreads) {
+        workers.push_back(std::thread([&c, f, &mutex, &next_chunk, &chunks, nchunks](void) {
+            for (uint32_t i = next_chunk++; i < nchunks; i = next_chunk++) {
                 try {
-                    std::shared_ptr<chunk_data> dat = c->read_chunk(i);
-                    f(i, dat, mutex);
+                    std::shared_ptr<chunk_data> dat = c->read_chunk(chunks[i]);
+                    f(chunks[i], dat, mutex);
                 } catch (std::string s) {
                     GCBS_ERROR(s);
                     continue;
                 } catch (...) {
-                    GCBS_ERROR("unexpected exception while processing chunk " + std::to_string(i));
+                    GCBS_ERROR("unexpected exception while processing chunk " + std::to_string(chunks[i]));
                     continue;
                 }
             }
@@ -1649,15 +1924,13 @@ void chunk_processor_multithread::apply(std::shared_ptr<cube> c,
     for (uint16_t it = 0; it < _nthreads; ++it) {
         workers[it].join();
     }
+    ncdf_cube::close_files();
+    stream_process::stop_all();
+    chunk_cache::instance()->clear();
 }
 
 
 std::shared_ptr<chunk_data> cube::to_double_array(std::shared_ptr<chunk_processor> p) {
-
-
-    // NOTE: the following will only work as long as all cube st reference types with regular spatial dimensions inherit from  cube_stref_regular class
-    std::shared_ptr<cube_stref_regular> stref = std::dynamic_pointer_cast<cube_stref_regular>(_st_ref);
-
     std::shared_ptr<chunk_data> out = std::make_shared<chunk_data>();
     coords_nd<uint32_t, 4> size_btyx = {_bands.count(), size_t(), size_y(), size_x()};
     out->size(size_btyx);
@@ -1665,42 +1938,71 @@ std::shared_ptr<chunk_data> cube::to_double_array(std::shared_ptr<chunk_processo
     if (size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3] == 0)
         return out;
 
-    // Fill buffers accordingly
-    out->buf(std::calloc(size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3], sizeof(double)));
-    double *begin = (double *)out->buf();
-    double *end = ((double *)out->buf()) + size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3];
-    std::fill(begin, end, NAN);
-
-
-    std::shared_ptr<progress> prg = config::instance()->get_default_progress_bar()->get();
-    prg->set(0);  // explicitly set to zero to show progress bar immediately
-
-    std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f = [this, out, prg](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
+    out->buf(std::malloc(size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3] * sizeof(double)));
+    to_double_array((double *)out->buf(), false, p);
+    return out;
+}
 
-        if (!dat->empty()) {
-            chunk_size_btyx csize = dat->size();
-            bounds_nd<uint32_t, 3> climits = chunk_limits(id);
+void cube::to_double_array(double *buf, bool band_fastest, std::shared_ptr<chunk_processor> p) {
+    const std::size_t nb = size_bands();
+    const std::size_t nt = size_t();
+    const std::size_t ny = size_y();
+    const std::size_t nx = size_x();
+    if (nb * nt * ny * nx == 0)
+        return;
 
-            for (uint16_t ib = 0; ib < dat->size()[0]; ++ib) {
-                for (uint32_t it = 0; it < dat->size()[1]; ++it) {
-                    for (uint32_t iy = 0; iy < dat->size()[2]; ++iy) {
-                        for (uint32_t ix = 0; ix < dat->size()[3]; ++ix) {
-                            ((double*)(out->buf()))[(ib) * (size_t()*size_y()*size_x()) +
-                                (climits.low[0]) * (size_y()*size_x()) + (size_y() - climits.high[1] - 1) * (size_x()) +
-                                (climits.low[2])] = ((double*)(dat->buf()))[ib * (csize[1]*csize[2]*csize[3]) + it * (csize[2]*csize[3]) + iy * (csize[3]) +  ix];
+    // Copies a chunk to its final position in buf, or fills its area with NAN if src is nullptr.
+    // Chunks do not overlap, so this can be called concurrently without locking.
+    auto copy_chunk = [this, buf, band_fastest, nb, nt, ny, nx](chunkid_t id, const double *src) {
+        bounds_nd<uint32_t, 3> climits = chunk_limits(id);
+        const std::size_t ct = climits.high[0] - climits.low[0] + 1;
+        const std::size_t cy = climits.high[1] - climits.low[1] + 1;
+        const std::size_t cx = climits.high[2] - climits.low[2] + 1;
+        for (std::size_t ib = 0; ib < nb; ++ib) {
+            for (std::size_t it = 0; it < ct; ++it) {
+                for (std::size_t iy = 0; iy < cy; ++iy) {
+                    const double *row = src ? src + ((ib * ct + it) * cy + iy) * cx : nullptr;
+                    const std::size_t gt = climits.low[0] + it;
+                    const std::size_t gy = climits.low[1] + iy;
+                    if (!band_fastest) {
+                        double *dst = buf + ((ib * nt + gt) * ny + gy) * nx + climits.low[2];
+                        if (row) {
+                            std::copy(row, row + cx, dst);
+                        } else {
+                            std::fill(dst, dst + cx, NAN);
+                        }
+                    } else {
+                        double *dst = buf + ib + nb * (gt + nt * (gy + ny * climits.low[2]));
+                        const std::size_t stride = nb * nt * ny;
+                        for (std::size_t ix = 0; ix < cx; ++ix) {
+                            dst[ix * stride] = row ? row[ix] : NAN;
                         }
                     }
                 }
             }
         }
+    };
+
+    std::shared_ptr<progress> prg = config::instance()->get_default_progress_bar()->get();
+    prg->set(0);  // explicitly set to zero to show progress bar immediately
+
+    // chunks that fail are not passed to f and must be filled afterwards
+    std::vector<char> done(count_chunks(), 0);
+    std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f = [this, prg, &copy_chunk, &done](chunkid_t id, std::shared_ptr<chunk_data> dat, std::mutex &m) {
+        if (!dat->empty() && dat->size()[0] == size_bands()) {
+            copy_chunk(id, (const double *)dat->buf());
+        } else {
+            copy_chunk(id, nullptr);
+        }
+        done[id] = 1;
         prg->increment((double)1 / (double)this->count_chunks());
     };
 
     p->apply(shared_from_this(), f);
+    for (chunkid_t id = 0; id < done.size(); ++id) {
+        if (!done[id]) copy_chunk(id, nullptr);
+    }
     prg->finalize();
-
-    return out;
-
 }
 
 
@@ -1738,7 +2040,8 @@ std::shared_ptr<chunk_data> cube::read_window(std::array<int32_t, 3> lower, std:
                 
                 // 1. Read chunk
                 chunkid_t chnk_id = chunk_id_from_coords({uint32_t(ict), uint32_t(icy), uint32_t(icx)}); // casting to unsigned needed?
-                std::shared_ptr<chunk_data> cin = this->read_chunk(chnk_id);
+                // neighbouring windows share input chunks, read through the cache to compute each chunk only once
+                std::shared_ptr<chunk_data> cin = this->read_chunk_cached(chnk_id);
                 if (cin->empty()) {
                     continue;
                 }
@@ -1758,22 +2061,24 @@ std::shared_ptr<chunk_data> cube::read_window(std::array<int32_t, 3> lower, std:
                 int32_t start_x = std::max(offst_x, 0);
                 int32_t end_x = std::min(int32_t(cin->size()[3]) - 1, offst_x + (upper[2] - lower[2]));
 
+                if (start_x > end_x) {
+                    continue;
+                }
                 for (int32_t ib = 0; ib < int32_t(cin->size()[0]); ++ib) {
                     for (int32_t it = start_t; it<=end_t; ++it) {
                         for (int32_t iy = start_y; iy<=end_y; ++iy) {
-                            for (int32_t ix = start_x; ix<=end_x; ++ix) {
-                                ((double*)(out->buf()))[
-                                    ib * size_tyx[0] * size_tyx[1] * size_tyx[2] + 
-                                    (it - offst_t) * size_tyx[1] * size_tyx[2] + 
-                                    (iy - offst_y) * size_tyx[2] + 
-                                    (ix - offst_x)] = 
-                                    ((double*)(cin->buf()))[
-                                        ib * (int32_t)cin->size()[1] * (int32_t)cin->size()[2] * cin->size()[3] + 
-                                        it * (int32_t)cin->size()[2] * (int32_t)cin->size()[3] + 
-                                        iy * (int32_t)cin->size()[3] + 
-                                        ix];
-                            }
-                        }   
+                            // copy contiguous rows
+                            const double* src = ((double*)(cin->buf())) +
+                                                ib * (int32_t)cin->size()[1] * (int32_t)cin->size()[2] * cin->size()[3] +
+                                                it * (int32_t)cin->size()[2] * (int32_t)cin->size()[3] +
+                                                iy * (int32_t)cin->size()[3] + start_x;
+                            double* dst = ((double*)(out->buf())) +
+                                          ib * size_tyx[0] * size_tyx[1] * size_tyx[2] +
+                                          (it - offst_t) * size_tyx[1] * size_tyx[2] +
+                                          (iy - offst_y) * size_tyx[2] +
+                                          (start_x - offst_x);
+                            std::copy(src, src + (end_x - start_x + 1), dst);
+                        }
                     }
                 }
             } 
@@ -1849,7 +2154,11 @@ void chunk_data::write_ncdf(std::string path, uint8_t compression_level, bool fo
     if (!empty()) {
         std::size_t startp[] = {0, 0, 0, 0};
         std::size_t countp[] = {this->size()[0], this->size()[1], this->size()[2], this->size()[3]};
-        nc_put_vara(ncout, v, startp, countp, this->buf()) ;
+        if (_type != value_type::FLOAT64) {
+            nc_put_vara(ncout, v, startp, countp, promote()->buf());
+        } else {
+            nc_put_vara(ncout, v, startp, countp, this->buf());
+        }
     }
     nc_close(ncout);
 }
@@ -1916,6 +2225,7 @@ void chunk_data::read_ncdf(std::string path) {
 
     this->size({uint32_t(nb),uint32_t(nt),uint32_t(ny),uint32_t(nx)});
     this->buf(std::malloc(sizeof(double) * nx * ny * nt * nb));
+    _type = value_type::FLOAT64;
     nc_get_var_double(ncfile, vid, (double*)(this->buf()));
 
     retval = nc_close(ncfile);
@@ -1924,5 +2234,46 @@ void chunk_data::read_ncdf(std::string path) {
     }
 }
 
+void chunk_data::write_raw(std::string path) {
+    std::ofstream o(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!o.is_open()) {
+        throw std::string("ERROR in chunk_data::write_raw(): cannot open file '" + path + "'");
+    }
+    int32_t header[7] = {(int32_t)_status, (int32_t)_type, (int32_t)_size[0], (int32_t)_size[1], (int32_t)_size[2], (int32_t)_size[3], empty() ? 0 : 1};
+    o.write("GCCH", 4);
+    o.write((const char *)header, sizeof(header));
+    if (!empty()) {
+        o.write((const char *)_buf, total_size_bytes());
+    }
+    o.close();
+    if (o.fail()) {
+        throw std::string("ERROR in chunk_data::write_raw(): failed to write file '" + path + "'");
+    }
+}
+
+void chunk_data::read_raw(std::string path) {
+    std::ifstream i(path, std::ios::in | std::ios::binary);
+    if (!i.is_open()) {
+        throw std::string("ERROR in chunk_data::read_raw(): cannot open file '" + path + "'");
+    }
+    char magic[4];
+    int32_t header[7];
+    i.read(magic, 4);
+    i.read((char *)header, sizeof(header));
+    if (i.fail() || std::strncmp(magic, "GCCH", 4) != 0) {
+        throw std::string("ERROR in chunk_data::read_raw(): '" + path + "' is not a valid chunk file");
+    }
+    set_status(static_cast<chunk_status>(header[0]));
+    if (header[6] == 0) {
+        return;  // chunk is empty
+    }
+    this->size({uint32_t(header[2]), uint32_t(header[3]), uint32_t(header[4]), uint32_t(header[5])});
+    _type = static_cast<value_type>(header[1]);
+    this->buf(std::malloc(total_size_bytes()));
+    i.read((char *)_buf, total_size_bytes());
+    if (i.fail()) {
+        throw std::string("ERROR in chunk_data::read_raw(): unexpected end of file '" + path + "'");
+    }
+}
 
 }  // namespace gdalcubes
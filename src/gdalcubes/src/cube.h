@@ -143,6 +143,9 @@ class chunk_processor_singlethread : public chunk_processor {
 
 /**
  * @brief Implementation of the chunk_processor class for multithreaded parallel chunk processing
+ *
+ * Chunks are not assigned to threads in advance but fetched from a shared atomic counter, such that
+ * threads that finished cheap (e.g. empty) chunks continue with the next available chunk.
  */
 class chunk_processor_multithread : public chunk_processor {
    public:
@@ -270,10 +273,25 @@ class chunk_data {
         UNKNOWN = 128
     };
 
+    /**
+     * @brief Element type of the chunk buffer
+     *
+     * Operations always produce and expect FLOAT64 chunks. Smaller types are used to store chunks compactly (e.g. in
+     * the chunk cache), see compact() and promote(). For integer types, NAN is represented by a reserved value
+     * (the maximum value of unsigned types and the minimum value of signed types).
+     */
+    enum class value_type {
+        UINT8,
+        UINT16,
+        INT16,
+        FLOAT32,
+        FLOAT64
+    };
+
     /**
      * @brief Default constructor that creates an empty chunk
      */
-    chunk_data() : _buf(nullptr), _size({{0, 0, 0, 0}}), _status(chunk_status::OK) {}
+    chunk_data() : _buf(nullptr), _size({{0, 0, 0, 0}}), _status(chunk_status::OK), _type(value_type::FLOAT64) {}
 
     ~chunk_data() {
         if (_buf && _size[0] * _size[1] * _size[2] * _size[3] > 0) std::free(_buf);
@@ -296,9 +314,44 @@ class chunk_data {
      * @return size of the chunk in bytes
      */
     uint64_t total_size_bytes() {
-        return empty() ? 0 : sizeof(double) * _size[0] * _size[1] * _size[2] * _size[3];
+        return empty() ? 0 : value_size(_type) * _size[0] * _size[1] * _size[2] * _size[3];
+    }
+
+    /**
+     * @brief Size of a single element of the given type in bytes
+     */
+    static uint8_t value_size(value_type t) {
+        switch (t) {
+            case value_type::UINT8:
+                return 1;
+            case value_type::UINT16:
+            case value_type::INT16:
+                return 2;
+            case value_type::FLOAT32:
+                return 4;
+            default:
+                return 8;
+        }
     }
 
+    /**
+     * @brief Query the element type of the chunk buffer
+     * @return element type, FLOAT64 unless the chunk has been created by compact()
+     */
+    inline value_type type() { return _type; }
+
+    /**
+     * @brief Create a compact copy of the chunk using the smallest element type that represents all values exactly
+     * @return new chunk, or nullptr if the chunk is empty, not of type FLOAT64, or if no smaller type is sufficient
+     */
+    std::shared_ptr<chunk_data> compact();
+
+    /**
+     * @brief Create a FLOAT64 copy of a compact chunk
+     * @return new chunk of type FLOAT64
+     */
+    std::shared_ptr<chunk_data> promote();
+
     /**
      * @brief Check whether there is data in the buffer
      * @return true, if there is no data in the buffer (either size == 0, or buf == nullptr)
@@ -319,7 +372,8 @@ class chunk_data {
      * @brief Access the raw buffer where the data is stored in memory
      *
      * This method is dangerous and provides direct access to the data buffer. Use with caution and never free any memory /
-     * remove / add vector elements if you don't know exactly what you do.
+     * remove / add vector elements if you don't know exactly what you do. Unless type() returns FLOAT64, the buffer
+     * does NOT contain double values.
      * @return void pointer pointing to the data buffer
      */
     inline void *buf() { return _buf; }
@@ -372,6 +426,22 @@ class chunk_data {
      */
     void read_ncdf(std::string path);
 
+    /**
+     * @brief Write a single chunk to a binary file
+     *
+     * @details
+     * The file contains a small header (chunk status, element type, and size) followed by the raw buffer in native
+     * byte order. It is meant for passing chunks between processes on the same machine, not for storage.
+     * @param path output path
+     */
+    void write_raw(std::string path);
+
+    /**
+     * @brief Read a single chunk from a binary file written by write_raw()
+     * @param path input path
+     */
+    void read_raw(std::string path);
+
 
     void set_status(chunk_status s) {
         _status = s;
@@ -385,6 +455,7 @@ class chunk_data {
     void *_buf;
     chunk_size_btyx _size;
     chunk_status _status; // error flags
+    value_type _type;
 };
 
 /**
@@ -405,17 +476,27 @@ class cube : public std::enable_shared_from_this<cube> {
     /**
      * @brief Create an empty data cube
      */
-    cube() : _st_ref(nullptr), _chunk_size({16, 256, 256}), _bands() {}
+    cube() : _st_ref(nullptr), _chunk_size({16, 256, 256}), _bands(), _uid(make_uid()) {}
 
     /**
      * @brief Create an empty data cube with given spacetime reference
      * @param st_ref space time reference (extent, size, SRS) of the cube
      */
-    cube(std::shared_ptr<cube_stref> st_ref) : _st_ref(st_ref), _chunk_size(), _bands(), _pre(), _succ() {
+    cube(std::shared_ptr<cube_stref> st_ref) : _st_ref(st_ref), _chunk_size(), _bands(), _pre(), _succ(), _uid(make_uid()) {
         _chunk_size = {16, 256, 256};
     }
 
-    virtual ~cube() {}
+    virtual ~cube();
+
+    /**
+     * @brief Unique identifier of this cube instance within the current process
+     *
+     * In contrast to the address of the object, identifiers are never reused, even after a cube has been destroyed.
+     * @return unique identifier
+     */
+    inline uint64_t uid() const {
+        return _uid;
+    }
 
     /**
      * @brief Find the chunk that contains a given point
@@ -496,6 +577,32 @@ class cube : public std::enable_shared_from_this<cube> {
         return c[0] * count_chunks_y() * count_chunks_x() + c[1] * count_chunks_x() + c[2];
     }
 
+    /**
+     * @brief List all chunk ids of the cube in a given traversal order
+     * @param order traversal order, chunk_order::AUTO uses suggest_chunk_order()
+     * @return vector of all chunk ids
+     */
+    std::vector<chunkid_t> chunk_sequence(chunk_order order = chunk_order::AUTO);
+
+    /**
+     * @brief Suggest an order in which chunks should be computed
+     *
+     * By default, cubes inherit the suggestion of their (first) input cube. Operations that read neighbouring
+     * chunks in time (e.g. moving window or time series interpolation) should override this and return
+     * chunk_order::TIME_FIRST, operations that read spatially neighbouring data should return chunk_order::ZORDER.
+     * The suggestion is ignored if a different order has been set with config::set_chunk_order().
+     * @return suggested chunk order, must not be chunk_order::AUTO
+     */
+    virtual chunk_order suggest_chunk_order() {
+        if (!_pre.empty()) {
+            std::shared_ptr<cube> in = _pre[0].lock();
+            if (in) {
+                return in->suggest_chunk_order();
+            }
+        }
+        return chunk_order::ID;
+    }
+
     /**
      * @brief Derive the true size of a specific chunk
      *
@@ -585,6 +692,18 @@ class cube : public std::enable_shared_from_this<cube> {
      */
     virtual std::shared_ptr<chunk_data> read_chunk(chunkid_t id) = 0;
 
+    /**
+     * @brief Read chunk data through the shared chunk cache
+     *
+     * Operations that read the same chunks of their input cube repeatedly (e.g. for neighbouring output chunks) should
+     * use this function instead of read_chunk(). Returned chunks may be shared with other readers and MUST NOT be modified.
+     *
+     * @param id the id of the requested chunk
+     * @return a smart pointer to (read-only) chunk data
+     * @see chunk_cache
+     */
+    std::shared_ptr<chunk_data> read_chunk_cached(chunkid_t id);
+
 
     /**
      * @brief Read a window subset of a data cube to a buffer
@@ -595,6 +714,9 @@ class cube : public std::enable_shared_from_this<cube> {
      * Areas outside the cube are always filled with NAN. 
      * Padding must be explicitly implemented in upstram code, if needed (e.g. window_space)
      * 
+     * Chunks are read with read_chunk_cached(), such that overlapping windows (e.g. of neighbouring
+     * output chunks in window_space) compute each input chunk only once as long as it fits in the chunk cache.
+     * 
      * 
      * @param lower coordinates of the lower pixel (cube coordinates)
      * @param upper coordinates of the upper point (cube coordinates)
@@ -658,8 +780,25 @@ class cube : public std::enable_shared_from_this<cube> {
     void write_chunks_netcdf(std::string dir, std::string name = "", uint8_t compression_level = 0,
                              std::shared_ptr<chunk_processor> p = config::instance()->get_default_chunk_processor());
 
+    /**
+     * @brief Evaluate the data cube in memory
+     * @param p chunk processor instance, defaults to the global configuration
+     * @return chunk data with all pixels of the cube in the order (band, t, y, x)
+     */
     std::shared_ptr<chunk_data> to_double_array(std::shared_ptr<chunk_processor> p = config::instance()->get_default_chunk_processor());
 
+    /**
+     * @brief Evaluate the data cube and write pixel values directly to an existing buffer
+     *
+     * Chunks are copied to their final position from the threads of the chunk processor as soon as they have been
+     * computed. Pixels of empty or failed chunks are set to NAN. Rows are ordered from top to bottom.
+     * @param buf buffer with size_bands() * size_t() * size_y() * size_x() elements
+     * @param band_fastest if false, buf is in the order (band, t, y, x) with x varying fastest, if true, the band
+     * index varies fastest (as in R arrays with dimensions band, t, y, x)
+     * @param p chunk processor instance, defaults to the global configuration
+     */
+    void to_double_array(double *buf, bool band_fastest = false, std::shared_ptr<chunk_processor> p = config::instance()->get_default_chunk_processor());
+
     void write_single_chunk_netcdf(chunkid_t id, std::string path, uint8_t compression_level = 0);
 
 
@@ -728,6 +867,13 @@ class cube : public std::enable_shared_from_this<cube> {
     bool _optim_is_chunk_local;  // TODO
     bool _optim_reccomend_cache_input; // TODO
 
+   private:
+    static uint64_t make_uid();
+
+    /**
+     * @brief Unique identifier of this cube instance, used as key in the chunk cache
+     */
+    uint64_t _uid;
 };
 
 }  // namespace gdalcubes
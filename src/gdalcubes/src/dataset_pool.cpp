@@ -0,0 +1,158 @@
+/*
+    MIT License
+
+    Copyright (c) 2026 Marius Appel <marius.appel@hs-bochum.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "dataset_pool.h"
+
+#include <cpl_vsi.h>
+
+#include "warp.h"
+
+namespace gdalcubes {
+
+GDALDataset* gdal_dataset_pool::acquire(std::string descriptor) {
+    check_modified(descriptor);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _idle_index.find(descriptor);
+        if (it != _idle_index.end()) {
+            GDALDataset* dataset = it->second->second;
+            _idle.erase(it->second);
+            _idle_index.erase(it);
+            _in_use[dataset] = descriptor;
+            ++_reused;
+            return dataset;
+        }
+    }
+
+    // open new dataset without holding the lock
+    GDALDataset* dataset = (GDALDataset*)GDALOpen(descriptor.c_str(), GA_ReadOnly);
+    if (!dataset) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    _in_use[dataset] = descriptor;
+    ++_opened;
+    evict(config::instance()->get_gdal_dataset_pool_max());
+    return dataset;
+}
+
+void gdal_dataset_pool::release(GDALDataset* dataset) {
+    if (!dataset) return;
+    uint32_t max_open = config::instance()->get_gdal_dataset_pool_max();
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _in_use.find(dataset);
+    if (it == _in_use.end()) {
+        GCBS_WARN("Dataset '" + std::string(dataset->GetDescription()) + "' has not been acquired from the dataset pool and will be closed");
+        GDALClose(dataset);
+        return;
+    }
+    std::string descriptor = it->second;
+    _in_use.erase(it);
+    if (max_open == 0) {
+        GDALClose(dataset);
+        return;
+    }
+    _idle.push_front(std::make_pair(descriptor, dataset));
+    _idle_index.insert(std::make_pair(descriptor, _idle.begin()));
+    evict(max_open);
+}
+
+void gdal_dataset_pool::revalidate() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_generation;
+}
+
+void gdal_dataset_pool::check_modified(std::string descriptor) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _files.find(descriptor);
+        if (it != _files.end() && it->second.generation == _generation) {
+            return;
+        }
+    }
+    file_state f = {-1, -1, 0};
+    VSIStatBufL st;
+    if (VSIStatL(descriptor.c_str(), &st) == 0) {
+        f.mtime = (int64_t)st.st_mtime;
+        f.size = (int64_t)st.st_size;
+    }
+
+    bool modified = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        f.generation = _generation;
+        auto it = _files.find(descriptor);
+        if (it != _files.end()) {
+            modified = it->second.mtime != f.mtime || it->second.size != f.size;
+        }
+        _files[descriptor] = f;
+        if (modified) {
+            auto range = _idle_index.equal_range(descriptor);
+            for (auto i = range.first; i != range.second; ++i) {
+                GDALClose(i->second->second);
+                _idle.erase(i->second);
+                ++_evicted;
+            }
+            _idle_index.erase(range.first, range.second);
+        }
+    }
+    if (modified) {
+        GCBS_DEBUG("File '" + descriptor + "' has been modified, reopening");
+        gdalwarp_client::overview_cache::instance()->remove(descriptor);
+    }
+}
+
+void gdal_dataset_pool::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    evict(0);
+}
+
+gdal_dataset_pool_stats gdal_dataset_pool::get_stats() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    gdal_dataset_pool_stats s;
+    s.opened = _opened;
+    s.reused = _reused;
+    s.evicted = _evicted;
+    s.open_idle = _idle.size();
+    s.open_in_use = _in_use.size();
+    return s;
+}
+
+void gdal_dataset_pool::evict(uint32_t max_open) {
+    // expects _mutex to be locked by the caller, datasets in use are never closed
+    while (!_idle.empty() && _idle.size() + _in_use.size() > max_open) {
+        auto range = _idle_index.equal_range(_idle.back().first);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second->second == _idle.back().second) {
+                _idle_index.erase(it);
+                break;
+            }
+        }
+        GDALClose(_idle.back().second);
+        _idle.pop_back();
+        ++_evicted;
+    }
+}
+
+}  // namespace gdalcubes
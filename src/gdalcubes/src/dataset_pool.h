@@ -0,0 +1,119 @@
+/*
+    MIT License
+
+    Copyright (c) 2026 Marius Appel <marius.appel@hs-bochum.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef DATASET_POOL_H
+#define DATASET_POOL_H
+
+#include <gdal_priv.h>
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "config.h"
+
+namespace gdalcubes {
+
+/**
+ * @brief Process-wide pool of opened read-only GDAL datasets
+ *
+ * Opening a GDAL dataset includes parsing its header and probing overviews, which for remote files (e.g. /vsicurl/)
+ * requires at least one HTTP request. Since neighbouring chunks often read from the same images, datasets are
+ * kept open after use and reused by subsequent reads of the same descriptor.
+ *
+ * GDAL datasets must not be used by multiple threads concurrently. Datasets are hence handed out exclusively by
+ * acquire() and must be given back with release(), after which they might be handed out to other threads.
+ * Idle datasets are closed in least recently used order if the number of open datasets exceeds
+ * config::get_gdal_dataset_pool_max(). A maximum of 0 disables pooling.
+ *
+ * Files might change between computations. After revalidate() has been called, the modification time and size of a
+ * file are compared to the values from its last use when the file is acquired the next time. Idle datasets and cached
+ * overview metadata of modified files are dropped. Descriptors that are not files (e.g. subdatasets) are not checked.
+ */
+class gdal_dataset_pool {
+   public:
+    static gdal_dataset_pool* instance() {
+        // never destroyed, idle datasets are closed in config::gdalcubes_cleanup()
+        static gdal_dataset_pool* instance = new gdal_dataset_pool();
+        return instance;
+    }
+
+    /**
+     * Get an opened read-only dataset for a given descriptor
+     * @param descriptor GDAL dataset descriptor (e.g. filename or URL)
+     * @return dataset or nullptr, if GDAL could not open the dataset
+     */
+    GDALDataset* acquire(std::string descriptor);
+
+    /**
+     * Give back a dataset that has been acquired before. The dataset must not be used afterwards.
+     * @param dataset dataset as returned from acquire()
+     */
+    void release(GDALDataset* dataset);
+
+    /**
+     * Check files for modifications when they are acquired the next time, called at the start of computations
+     */
+    void revalidate();
+
+    /**
+     * Close all idle datasets
+     */
+    void clear();
+
+    gdal_dataset_pool_stats get_stats();
+
+   private:
+    gdal_dataset_pool(const gdal_dataset_pool&) = delete;
+    gdal_dataset_pool(gdal_dataset_pool&&) = delete;
+    gdal_dataset_pool& operator=(const gdal_dataset_pool&) = delete;
+    gdal_dataset_pool& operator=(gdal_dataset_pool&&) = delete;
+    gdal_dataset_pool() : _idle(), _idle_index(), _in_use(), _files(), _generation(0), _opened(0), _reused(0), _evicted(0), _mutex() {}
+
+    typedef std::list<std::pair<std::string, GDALDataset*>> idle_list;
+
+    struct file_state {
+        int64_t mtime;
+        int64_t size;
+        uint64_t generation;  // value of _generation when the file has been checked last
+    };
+
+    void check_modified(std::string descriptor);
+    void evict(uint32_t max_open);
+
+    idle_list _idle;  // most recently used first
+    std::unordered_multimap<std::string, idle_list::iterator> _idle_index;
+    std::unordered_map<GDALDataset*, std::string> _in_use;
+    std::unordered_map<std::string, file_state> _files;
+    uint64_t _generation;
+    uint64_t _opened;
+    uint64_t _reused;
+    uint64_t _evicted;
+    std::mutex _mutex;
+};
+
+}  // namespace gdalcubes
+
+#endif  // DATASET_POOL_H
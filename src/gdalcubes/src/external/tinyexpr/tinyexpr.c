@@ -29,6 +29,9 @@
  * - added bitwise infix operators &, |, <<, >> and bitwise not ~
  * - added isnan(), isfinite(), and iif() functions
  * - commented out pn() and te_print()
+ *
+ * FURTHER MODIFICATIONS:
+ * - added te_builtin_op() to identify built-in operators and functions in compiled expressions
  */
 
 
@@ -342,6 +345,33 @@ static double negate(double a) {return -a;}
 static double comma(double a, double b) {(void)a; return b;}
 
 
+int te_builtin_op(const te_expr *n) {
+    if (!n || !IS_FUNCTION(n->type)) return TE_OP_NONE;
+    const funcptr f = n->binding.function;
+    if (f == (funcptr)add) return TE_OP_ADD;
+    if (f == (funcptr)sub) return TE_OP_SUB;
+    if (f == (funcptr)mul) return TE_OP_MUL;
+    if (f == (funcptr)divide) return TE_OP_DIV;
+    if (f == (funcptr)negate) return TE_OP_NEG;
+    if (f == (funcptr)comma) return TE_OP_COMMA;
+    if (f == (funcptr)lt) return TE_OP_LT;
+    if (f == (funcptr)lte) return TE_OP_LTE;
+    if (f == (funcptr)gt) return TE_OP_GT;
+    if (f == (funcptr)gte) return TE_OP_GTE;
+    if (f == (funcptr)eq) return TE_OP_EQ;
+    if (f == (funcptr)neq) return TE_OP_NEQ;
+    if (f == (funcptr)land) return TE_OP_AND;
+    if (f == (funcptr)lor) return TE_OP_OR;
+    if (f == (funcptr)lnot) return TE_OP_NOT;
+    if (f == (funcptr)iif) return TE_OP_IFELSE;
+    if (f == (funcptr)is_nan) return TE_OP_ISNAN;
+    if (f == (funcptr)is_finite) return TE_OP_ISFINITE;
+    if (f == (funcptr)fabs) return TE_OP_ABS;
+    if (f == (funcptr)sqrt) return TE_OP_SQRT;
+    return TE_OP_NONE;
+}
+
+
 union te_symbol {
   const te_variable *var;
   const te_function *func;
@@ -86,6 +86,18 @@ void te_print(const te_expr *n);
 /* This is safe to call on NULL pointers. */
 void te_free(te_expr *n);
 
+/* Built-in operators and functions as identified by te_builtin_op() */
+enum {
+    TE_OP_NONE = 0,
+    TE_OP_ADD, TE_OP_SUB, TE_OP_MUL, TE_OP_DIV, TE_OP_NEG, TE_OP_COMMA,
+    TE_OP_LT, TE_OP_LTE, TE_OP_GT, TE_OP_GTE, TE_OP_EQ, TE_OP_NEQ,
+    TE_OP_AND, TE_OP_OR, TE_OP_NOT, TE_OP_IFELSE, TE_OP_ISNAN, TE_OP_ISFINITE,
+    TE_OP_ABS, TE_OP_SQRT
+};
+
+/* Returns the built-in operator or function of a function node, or TE_OP_NONE. */
+int te_builtin_op(const te_expr *n);
+
 
 #ifdef __cplusplus
 }
@@ -26,15 +26,19 @@ std::shared_ptr<chunk_data> fill_time_cube::read_chunk(chunkid_t id) {
     //std::vector<std::shared_ptr<chunk_data>> r_chunks;
 
     std::unordered_map<chunkid_t, std::shared_ptr<chunk_data>> in_chunks;
-    auto ic = _in_cube->read_chunk(id);
+    auto ic = _in_cube->read_chunk_cached(id);
     out->set_status(ic->status());  // propagate chunk status
 
     in_chunks.insert(std::pair<chunkid_t, std::shared_ptr<chunk_data>>(id, ic));
 
     if (in_chunks[id]->empty()) {  // if input chunk is empty, fill with NANs
-        in_chunks[id]->size(size_btyx);
-        in_chunks[id]->buf(std::calloc(size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3], sizeof(double)));
-        std::fill((double*)(in_chunks[id]->buf()), ((double*)(in_chunks[id]->buf())) + size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3], NAN);
+        // input chunks may be shared via the chunk cache, do not modify them but use a new chunk instead
+        std::shared_ptr<chunk_data> nan_chunk = std::make_shared<chunk_data>();
+        nan_chunk->size(size_btyx);
+        nan_chunk->buf(std::calloc(size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3], sizeof(double)));
+        std::fill((double*)(nan_chunk->buf()), ((double*)(nan_chunk->buf())) + size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3], NAN);
+        nan_chunk->set_status(ic->status());
+        in_chunks[id] = nan_chunk;
     }
 
     // iterate over all pixel time series
@@ -60,7 +64,7 @@ std::shared_ptr<chunk_data> fill_time_cube::read_chunk(chunkid_t id) {
                 while (prev_chunk >= 0 && !found) {
                     // load chunk (only if needed)
                     if (in_chunks.find(prev_chunk) == in_chunks.end()) {
-                        auto ic = _in_cube->read_chunk(prev_chunk);
+                        auto ic = _in_cube->read_chunk_cached(prev_chunk);
                         // propagate chunk status
                         if (ic->status() == chunk_data::chunk_status::ERROR) {
                             out->set_status(chunk_data::chunk_status::ERROR);
@@ -98,7 +102,7 @@ std::shared_ptr<chunk_data> fill_time_cube::read_chunk(chunkid_t id) {
                 while (next_chunk < (int32_t)_in_cube->count_chunks() && !found) {
                     // load chunk (only if needed)
                     if (in_chunks.find(next_chunk) == in_chunks.end()) {
-                        auto ic = _in_cube->read_chunk(next_chunk);
+                        auto ic = _in_cube->read_chunk_cached(next_chunk);
                         // propagate chunk status
                         if (ic->status() == chunk_data::chunk_status::ERROR) {
                             out->set_status(chunk_data::chunk_status::ERROR);
@@ -106,7 +110,7 @@ std::shared_ptr<chunk_data> fill_time_cube::read_chunk(chunkid_t id) {
                         else if (ic->status() == chunk_data::chunk_status::INCOMPLETE && out->status() != chunk_data::chunk_status::ERROR) {
                             out->set_status(chunk_data::chunk_status::INCOMPLETE);
                         }
-                        in_chunks.insert(std::pair<chunkid_t, std::shared_ptr<chunk_data>>(next_chunk, _in_cube->read_chunk(next_chunk)));
+                        in_chunks.insert(std::pair<chunkid_t, std::shared_ptr<chunk_data>>(next_chunk, ic));
                     }
                     if (!in_chunks[next_chunk]->empty()) {
                         chunk_size_tyx cs = _in_cube->chunk_size(next_chunk);
@@ -191,7 +195,7 @@ std::shared_ptr<chunk_data> fill_time_cube::read_chunk(chunkid_t id) {
                     while (next_chunk < (int32_t)_in_cube->count_chunks() && !found) {
                         // load chunk (only if needed)
                         if (in_chunks.find(next_chunk) == in_chunks.end()) {
-                            in_chunks.insert(std::pair<chunkid_t, std::shared_ptr<chunk_data>>(next_chunk, _in_cube->read_chunk(next_chunk)));
+                            in_chunks.insert(std::pair<chunkid_t, std::shared_ptr<chunk_data>>(next_chunk, _in_cube->read_chunk_cached(next_chunk)));
                         }
                         if (!in_chunks[next_chunk]->empty()) {
                             chunk_size_tyx cs = _in_cube->chunk_size(next_chunk);
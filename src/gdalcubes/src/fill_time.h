@@ -53,6 +53,11 @@ class fill_time_cube : public cube {
 
     std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
 
+    chunk_order suggest_chunk_order() override {
+        // adjacent chunks in time share input chunks
+        return chunk_order::TIME_FIRST;
+    }
+
     json11::Json make_constructible_json() override {
         json11::Json::object out;
         out["cube_type"] = "fill_time";
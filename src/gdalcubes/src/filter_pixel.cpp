@@ -24,8 +24,6 @@
 
 #include "filter_pixel.h"
 
-#include "external/tinyexpr/tinyexpr.h"
-
 #include <cstring>
 
 
@@ -45,31 +43,6 @@ std::shared_ptr<chunk_data> filter_pixel_cube::read_chunk(chunkid_t id) {
         return out;
     }
 
-    // Parse expressions and create symbol table
-    std::vector<double> values;
-    values.resize(_in_cube->bands().count(), NAN);
-    // WARNING: never change size of values from now
-
-    // TODO: add further variables like x, y, t to symbol table
-
-    std::vector<te_variable> vars;
-    for (uint16_t i = 0; i < _in_cube->bands().count(); ++i) {
-        char* varname = new char[_in_cube->bands().get(i).name.length() + 1];
-        std::string temp_name = _in_cube->bands().get(i).name;
-        std::transform(temp_name.begin(), temp_name.end(), temp_name.begin(), ::tolower);
-        std::strncpy(varname, temp_name.c_str(), temp_name.length() + 1);
-        vars.push_back({varname, &values[i]});
-    }
-
-    int err;
-    te_expr* expr = te_compile(_pred.c_str(), vars.data(), vars.size(), &err);
-    if (!expr) {
-        std::string msg = "Cannot parse predicate '" + _pred + "': error at token " + std::to_string(err);
-        GCBS_ERROR(msg);
-        te_free(expr);
-        return out;
-    }
-
     out->size({_bands.count(), in->size()[1], in->size()[2], in->size()[3]});
     out->buf(std::calloc(_bands.count() * in->size()[1] * in->size()[2] * in->size()[3], sizeof(double)));
 
@@ -78,26 +51,22 @@ std::shared_ptr<chunk_data> filter_pixel_cube::read_chunk(chunkid_t id) {
     //double *end = ((double *)out->buf()) + size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3];
     // std::fill(begin, end, NAN);
 
-    for (uint32_t i = 0; i < in->size()[1] * in->size()[2] * in->size()[3]; ++i) {
-        for (uint16_t inb = 0; inb < in->size()[0]; ++inb) {
-            values[inb] = ((double*)in->buf())[inb * in->size()[1] * in->size()[2] * in->size()[3] + i];
-        }
-        if (te_eval(expr) != 0) {
-            for (uint16_t ib = 0; ib < _bands.count(); ++ib) {
-                ((double*)out->buf())[ib * in->size()[1] * in->size()[2] * in->size()[3] + i] = ((double*)in->buf())[ib * in->size()[1] * in->size()[2] * in->size()[3] + i];
-            }
-        } else {
-            for (uint16_t ib = 0; ib < _bands.count(); ++ib) {
-                ((double*)out->buf())[ib * in->size()[1] * in->size()[2] * in->size()[3] + i] = NAN;
-            }
+    uint32_t npix = in->size()[1] * in->size()[2] * in->size()[3];
+    std::vector<const double*> vars;
+    for (uint16_t i = 0; i < _in_cube->bands().count(); ++i) {
+        vars.push_back(((double*)in->buf()) + i * npix);
+    }
+    std::vector<double> mask(npix);
+    _compiled->eval(vars, npix, mask.data());
+
+    for (uint16_t ib = 0; ib < _bands.count(); ++ib) {
+        double* in_band = ((double*)in->buf()) + ib * npix;
+        double* out_band = ((double*)out->buf()) + ib * npix;
+        for (uint32_t i = 0; i < npix; ++i) {
+            out_band[i] = (mask[i] != 0) ? in_band[i] : NAN;
         }
     }
 
-    te_free(expr);
-
-    for (uint16_t i = 0; i < _in_cube->bands().count(); ++i) {  // only free name of actual variables (not functions)
-        delete[] vars[i].name;
-    }
     // check if chunk is completely NAN and if yes, return empty chunk
     if (out->all_nan()) {
         chunk_data::chunk_status s = out->status();
@@ -109,33 +78,21 @@ std::shared_ptr<chunk_data> filter_pixel_cube::read_chunk(chunkid_t id) {
 }
 
 bool filter_pixel_cube::parse_predicate() {
-    bool res = true;
-    std::vector<double> dummy_values;
-    std::vector<::te_variable> vars;
+    std::vector<std::string> vars;
     for (uint16_t i = 0; i < _in_cube->bands().count(); ++i) {
-        dummy_values.push_back(1.0);
-        char* varname = new char[_in_cube->bands().get(i).name.length() + 1];
         std::string temp_name = _in_cube->bands().get(i).name;
         std::transform(temp_name.begin(), temp_name.end(), temp_name.begin(), ::tolower);
-        std::strncpy(varname, temp_name.c_str(), temp_name.length() + 1);
-        vars.push_back({varname, &dummy_values[i]});
+        vars.push_back(temp_name);
     }
 
-    int err = 0;
-
-    te_expr* expr = te_compile(_pred.c_str(), vars.data(), vars.size(), &err);
-    if (expr) {
-        te_free(expr);
-    } else {
-        res = false;
-        std::string msg = "Cannot parse predicate'" + _pred + "': error at token " + std::to_string(err);
+    try {
+        _compiled = std::make_shared<pixel_expression>(_pred, vars);
+    } catch (std::string err) {
+        std::string msg = "Cannot parse predicate '" + _pred + "': " + err;
         GCBS_ERROR(msg);
-        // Continue anyway to process all expressions
-    }
-    for (uint16_t i = 0; i < _in_cube->bands().count(); ++i) {  // only free name of actual variables (not functions)
-        delete[] vars[i].name;
+        return false;
     }
-    return res;
+    return true;
 }
 
 }  // namespace gdalcubes
@@ -21,6 +21,7 @@
 #include <string>
 
 #include "cube.h"
+#include "pixel_expression.h"
 
 struct te_variable;  // forward declaration for add_default_functions
 
@@ -57,7 +58,7 @@ class filter_pixel_cube : public cube {
          * @param expr vector of string expressions, each expression will result in a new band in the resulting cube where values are derived from the input cube according to the specific expression
          * @param band_names specify names for the bands of the resulting cube, if empty, "band1", "band2", "band3", etc. will be used as names
          */
-    filter_pixel_cube(std::shared_ptr<cube> in, std::string predicate) : cube(in->st_reference()->copy()), _in_cube(in), _pred(predicate) {  // it is important to duplicate st reference here, otherwise changes will affect input cube as well
+    filter_pixel_cube(std::shared_ptr<cube> in, std::string predicate) : cube(in->st_reference()->copy()), _in_cube(in), _pred(predicate), _compiled() {  // it is important to duplicate st reference here, otherwise changes will affect input cube as well
         _chunk_size[0] = _in_cube->chunk_size()[0];
         _chunk_size[1] = _in_cube->chunk_size()[1];
         _chunk_size[2] = _in_cube->chunk_size()[2];
@@ -70,9 +71,7 @@ class filter_pixel_cube : public cube {
 
         std::transform(_pred.begin(), _pred.end(), _pred.begin(), ::tolower);
 
-        // parse expressions, currently this is only for validation,
-        // expressions will be parsed again in read_chunk(), costs should
-        // be negligible compared to the actual evaluation
+        // the predicate is compiled once and evaluated for all chunks
         if (!parse_predicate()) {
             GCBS_ERROR("Invalid predicate");
             throw std::string("ERROR in filter_pixel_cube::filter_pixel_cube(): Invalid predicate");
@@ -95,6 +94,7 @@ class filter_pixel_cube : public cube {
    private:
     std::shared_ptr<cube> _in_cube;
     std::string _pred;
+    std::shared_ptr<pixel_expression> _compiled;
 
     bool parse_predicate();
 };
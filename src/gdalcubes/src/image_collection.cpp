@@ -38,7 +38,7 @@
 
 namespace gdalcubes {
 
-image_collection::image_collection() : _format(), _filename(""), _db(nullptr) {
+image_collection::image_collection() : _format(), _filename(""), _db(nullptr), _st_index_changes(-1), _st_index_data_version(-1), _st_index_batch(-1), _st_index_failed_batch(-1), _st_index_readers(0), _st_index_mutex(), _st_index_cv(), _stmt_cache(), _stmt_cache_mutex() {
     if (sqlite3_open_v2("", &_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, NULL) != SQLITE_OK) {
         std::string msg = "ERROR in image_collection::create(): cannot create temporary image collection file.";
         throw msg;
@@ -131,7 +131,7 @@ image_collection::image_collection(collection_format format) : image_collection(
     }
 }
 
-image_collection::image_collection(std::string filename) : _format(), _filename(filename), _db(nullptr) {
+image_collection::image_collection(std::string filename) : _format(), _filename(filename), _db(nullptr), _st_index_changes(-1), _st_index_data_version(-1), _st_index_batch(-1), _st_index_failed_batch(-1), _st_index_readers(0), _st_index_mutex(), _st_index_cv(), _stmt_cache(), _stmt_cache_mutex() {
     // TODO: IMPLEMENT VERSIONING OF COLLECTION FORMATS AND CHECK COMPATIBILITY HERE
     if (!filesystem::exists(filename)) {
         throw std::string("ERROR in image_collection::image_collection(): input collection '" + filename + "' does not exist.");
@@ -160,6 +160,12 @@ image_collection::image_collection(std::string filename) : _format(), _filename(
 }
 
 image_collection::~image_collection() {
+    for (auto it = _stmt_cache.begin(); it != _stmt_cache.end(); ++it) {
+        for (auto its = it->second.begin(); its != it->second.end(); ++its) {
+            sqlite3_finalize(*its);
+        }
+    }
+    _stmt_cache.clear();
     if (_db) {
         sqlite3_close(_db);
         _db = nullptr;
@@ -1370,17 +1376,147 @@ bounds_st image_collection::extent() {
     return out;
 }
 
+std::atomic<int64_t> image_collection::_query_batch(0);
+
+bool image_collection::prepare_st_index() {
+    std::unique_lock<std::mutex> lock(_st_index_mutex);
+    while (true) {
+        if (_st_index_changes == -2) {
+            return false;
+        }
+        int64_t batch = _query_batch;
+        // total changes count modifications by this connection
+        bool unchanged = _st_index_changes >= 0 && _st_index_changes == sqlite3_total_changes(_db);
+        if (unchanged && _st_index_batch == batch) {
+            ++_st_index_readers;
+            return true;
+        }
+        if (!unchanged && _st_index_failed_batch == batch) {
+            return false;
+        }
+
+        // data_version changes if the database file has been modified by other connections
+        int64_t data_version = -1;
+        sqlite3_stmt* stmt = get_cached_statement("PRAGMA data_version;");
+        if (stmt) {
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                data_version = sqlite3_column_int64(stmt, 0);
+            }
+            release_cached_statement("PRAGMA data_version;", stmt);
+        }
+        if (unchanged && _st_index_data_version == data_version) {
+            _st_index_batch = batch;
+            ++_st_index_readers;
+            return true;
+        }
+
+        // Dropping the index fails with SQLITE_LOCKED while statements reading it are active,
+        // wait until running queries have finished and check again
+        if (_st_index_readers > 0) {
+            _st_index_cv.wait(lock, [this]() { return _st_index_readers == 0; });
+            continue;
+        }
+        // cached statements have been reset, finalize them anyway such that none of them refers to the dropped table
+        {
+            std::lock_guard<std::mutex> lock_stmt(_stmt_cache_mutex);
+            for (auto it = _stmt_cache.begin(); it != _stmt_cache.end(); ++it) {
+                for (auto its = it->second.begin(); its != it->second.end(); ++its) {
+                    sqlite3_finalize(*its);
+                }
+            }
+            _stmt_cache.clear();
+        }
+
+        // Coordinates in R*Trees are stored as 32 bit floats, rounded such that boxes always contain the original extent.
+        // The index hence returns a superset of matching images, exact predicates are still evaluated in find_range_st().
+        // Datetime is stored as seconds since epoch, images with invalid datetime or extent get an infinite box.
+        std::string sql =
+            "DROP TABLE IF EXISTS temp.images_st_index;"
+            "CREATE VIRTUAL TABLE temp.images_st_index USING rtree(id, min_x, max_x, min_y, max_y, min_t, max_t);"
+            "INSERT INTO temp.images_st_index SELECT id, "
+            "COALESCE(min(left, right), -1e30), COALESCE(max(left, right), 1e30), "
+            "COALESCE(min(bottom, top), -1e30), COALESCE(max(bottom, top), 1e30), "
+            "COALESCE(CAST(strftime('%s', datetime) AS REAL), -1e30), COALESCE(CAST(strftime('%s', datetime) AS REAL), 1e30) FROM images;";
+        if (sqlite3_exec(_db, sql.c_str(), NULL, NULL, NULL) != SQLITE_OK) {
+            std::string msg = sqlite3_errmsg(_db);
+            sqlite3_exec(_db, "DROP TABLE IF EXISTS temp.images_st_index;", NULL, NULL, NULL);
+            _st_index_changes = -1;
+            if (msg.find("no such module") != std::string::npos) {
+                GCBS_DEBUG("SQLite R*Tree module is not available (" + msg + "), falling back to full table scans");
+                _st_index_changes = -2;
+            } else {
+                // errors might be temporary (e.g. locked database), try again with the next batch
+                GCBS_DEBUG("Failed to create spatiotemporal image index (" + msg + "), falling back to full table scans");
+                _st_index_failed_batch = batch;
+            }
+            return false;
+        }
+        _st_index_changes = sqlite3_total_changes(_db);
+        _st_index_data_version = data_version;
+        _st_index_batch = batch;
+        ++_st_index_readers;
+        return true;
+    }
+}
+
+void image_collection::release_st_index() {
+    std::lock_guard<std::mutex> lock(_st_index_mutex);
+    if (--_st_index_readers == 0) {
+        _st_index_cv.notify_all();
+    }
+}
+
+sqlite3_stmt* image_collection::get_cached_statement(std::string sql) {
+    {
+        std::lock_guard<std::mutex> lock(_stmt_cache_mutex);
+        auto it = _stmt_cache.find(sql);
+        if (it != _stmt_cache.end() && !it->second.empty()) {
+            sqlite3_stmt* stmt = it->second.back();
+            it->second.pop_back();
+            return stmt;
+        }
+    }
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(_db, sql.c_str(), -1, &stmt, NULL);
+    return stmt;
+}
+
+void image_collection::release_cached_statement(std::string sql, sqlite3_stmt* stmt) {
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    std::lock_guard<std::mutex> lock(_stmt_cache_mutex);
+    _stmt_cache[sql].push_back(stmt);
+}
+
 std::vector<image_collection::find_range_st_row> image_collection::find_range_st(bounds_st range, std::string srs,
                                                                                  std::vector<std::string> bands, std::vector<std::string> order_by) {
     bounds_2d<double> range_trans = (srs == "EPSG:4326") ? range.s : range.s.transform(srs, "EPSG:4326");
+
+    // The query contains only placeholders for the spatiotemporal range such that prepared statements can be reused
+    // for all chunks of a cube. Parameters: ?1 = left, ?2 = right, ?3 = bottom, ?4 = top, ?5 = t0, ?6 = t1
     std::string sql =  // TODO: do we really need image_name ?
-        "SELECT gdalrefs.image_id, images.name, gdalrefs.descriptor, images.datetime, bands.name, gdalrefs.band_num, images.proj "
-        "FROM images INNER JOIN gdalrefs ON images.id = gdalrefs.image_id INNER JOIN bands ON gdalrefs.band_id = bands.id WHERE "
-        "strftime('%Y-%m-%dT%H:%M:%S', images.datetime) >= '" +
-        range.t0.to_string(datetime_unit::SECOND) + "' AND strftime('%Y-%m-%dT%H:%M:%S', images.datetime) <= '" + range.t1.to_string(datetime_unit::SECOND) +
-        "' AND NOT "
-        "(images.right < " +
-        std::to_string(range_trans.left) + " OR images.left > " + std::to_string(range_trans.right) + " OR images.bottom > " + std::to_string(range_trans.top) + " OR images.top < " + std::to_string(range_trans.bottom) + ")";
+        "SELECT gdalrefs.image_id, images.name, gdalrefs.descriptor, images.datetime, bands.name, gdalrefs.band_num, images.proj, "
+        "images.left, images.right, images.bottom, images.top, strftime('%Y-%m-%dT%H:%M:%S', images.datetime) ";
+    bool use_index = prepare_st_index();
+    // releases the index after the query, also if an exception is thrown
+    struct st_index_guard {
+        image_collection* ic;
+        bool active;
+        ~st_index_guard() {
+            if (active) ic->release_st_index();
+        }
+    } index_guard = {this, use_index};
+    if (use_index) {
+        sql +=
+            "FROM temp.images_st_index INNER JOIN images ON images.id = images_st_index.id INNER JOIN gdalrefs ON images.id = gdalrefs.image_id INNER JOIN bands ON gdalrefs.band_id = bands.id WHERE "
+            "images_st_index.max_x >= ?1 AND images_st_index.min_x <= ?2 AND images_st_index.max_y >= ?3 AND images_st_index.min_y <= ?4 AND "
+            "images_st_index.max_t >= CAST(strftime('%s', ?5) AS REAL) AND images_st_index.min_t <= CAST(strftime('%s', ?6) AS REAL) AND ";
+    } else {
+        sql += "FROM images INNER JOIN gdalrefs ON images.id = gdalrefs.image_id INNER JOIN bands ON gdalrefs.band_id = bands.id WHERE ";
+    }
+    sql +=
+        "strftime('%Y-%m-%dT%H:%M:%S', images.datetime) >= ?5 AND strftime('%Y-%m-%dT%H:%M:%S', images.datetime) <= ?6 "
+        "AND NOT (images.right < ?1 OR images.left > ?2 OR images.bottom > ?4 OR images.top < ?3)";
 
     if (!bands.empty()) {
         std::string bandlist = "";
@@ -1391,7 +1527,7 @@ std::vector<image_collection::find_range_st_row> image_collection::find_range_st
         sql += " AND bands.name IN (" + bandlist + ")";
     }
     if (!order_by.empty()) {
-        sql += "ORDER BY ";
+        sql += " ORDER BY ";
         for (uint16_t io = 0; io < order_by.size() - 1; ++io) {
             if (order_by[io] == "gdalrefs.image_id" ||
                 order_by[io] == "images.name" ||
@@ -1420,11 +1556,19 @@ std::vector<image_collection::find_range_st_row> image_collection::find_range_st
     }
     sql += ";";
 
-    sqlite3_stmt* stmt;
-    sqlite3_prepare_v2(_db, sql.c_str(), -1, &stmt, NULL);
+    sqlite3_stmt* stmt = get_cached_statement(sql);
     if (!stmt) {
         throw std::string("ERROR in image_collection::find_range_st(): cannot prepare query statement");
     }
+    std::string t0 = range.t0.to_string(datetime_unit::SECOND);
+    std::string t1 = range.t1.to_string(datetime_unit::SECOND);
+    sqlite3_bind_double(stmt, 1, range_trans.left);
+    sqlite3_bind_double(stmt, 2, range_trans.right);
+    sqlite3_bind_double(stmt, 3, range_trans.bottom);
+    sqlite3_bind_double(stmt, 4, range_trans.top);
+    sqlite3_bind_text(stmt, 5, t0.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 6, t1.c_str(), -1, SQLITE_TRANSIENT);
+
     std::vector<find_range_st_row> out;
     while (sqlite3_step(stmt) == SQLITE_ROW) {
         find_range_st_row r;
@@ -1435,10 +1579,15 @@ std::vector<image_collection::find_range_st_row> image_collection::find_range_st
         r.band_name = sqlite_as_string(stmt, 4);
         r.band_num = sqlite3_column_int(stmt, 5);
         r.srs = sqlite_as_string(stmt, 6);
+        r.left = sqlite3_column_double(stmt, 7);
+        r.right = sqlite3_column_double(stmt, 8);
+        r.bottom = sqlite3_column_double(stmt, 9);
+        r.top = sqlite3_column_double(stmt, 10);
+        r.datetime_norm = sqlite_as_string(stmt, 11);
 
         out.push_back(r);
     }
-    sqlite3_finalize(stmt);
+    release_cached_statement(sql, stmt);
     return out;
 }
 
@@ -27,6 +27,11 @@
 
 //#include <ogr_spatialref.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
 #include "collection_format.h"
 #include "coord_types.h"
 #include "datetime.h"
@@ -96,7 +101,7 @@ class image_collection {
     void operator=(const image_collection&) = delete;
 
     // move constructor
-    image_collection(image_collection&& A) : _format(A._format), _filename(A._filename), _db(A._db) {}
+    image_collection(image_collection&& A) : _format(A._format), _filename(A._filename), _db(A._db), _st_index_changes(-1), _st_index_data_version(-1), _st_index_batch(-1), _st_index_failed_batch(-1), _st_index_readers(0), _st_index_mutex(), _st_index_cv(), _stmt_cache(), _stmt_cache_mutex() {}
 
     static std::shared_ptr<image_collection> create(collection_format format, std::vector<std::string> descriptors, bool strict = true);
     static std::shared_ptr<image_collection> create(std::vector<std::string> descriptors, std::vector<std::string> date_time,
@@ -187,7 +192,8 @@ class image_collection {
     uint32_t count_gdalrefs();
 
     struct find_range_st_row {
-        find_range_st_row() : image_id(0), image_name(""), descriptor(""), datetime(""), band_name(""), band_num(1) {}
+        find_range_st_row() : image_id(0), image_name(""), descriptor(""), datetime(""), band_name(""), band_num(1), srs(""),
+                              left(0), right(0), bottom(0), top(0), datetime_norm("") {}
         uint32_t image_id;
         std::string image_name;
         std::string descriptor;
@@ -195,6 +201,11 @@ class image_collection {
         std::string band_name;
         uint16_t band_num;
         std::string srs;
+        double left;  // WGS84 extent of the image
+        double right;
+        double bottom;
+        double top;
+        std::string datetime_norm;  // datetime as used in datetime comparisons (%Y-%m-%dT%H:%M:%S)
     };
     std::vector<find_range_st_row> find_range_st(bounds_st range, std::string srs,
                                                  std::vector<std::string> bands, std::vector<std::string> order_by = {});
@@ -202,6 +213,21 @@ class image_collection {
         return find_range_st(range, srs, std::vector<std::string>(), order_by);
     };
 
+    /**
+     * Start a new batch of find_range_st() queries, e.g. at the start of a computation. Whether image collection files have
+     * been modified by other connections is checked only once per batch.
+     */
+    static void next_query_batch() {
+        ++_query_batch;
+    }
+
+    /**
+     * Return the current batch of find_range_st() queries, see next_query_batch()
+     */
+    static int64_t query_batch() {
+        return _query_batch;
+    }
+
     /**
      * Return available bands of an image collection. Bands without
      * correspoding datasets are omitted.
@@ -306,6 +332,42 @@ class image_collection {
     std::string _filename;
     sqlite3* _db;
 
+    /**
+     * Create or update a temporary R*Tree index over the spatiotemporal extent of all images, which is used to
+     * speed up find_range_st(). The index lives in the temp schema of the connection, i.e. the collection file is never
+     * modified. It is rebuilt automatically if the collection has been modified since its creation, where modifications
+     * by other connections are checked once per query batch (see next_query_batch()). Rebuilding waits until running queries
+     * have finished. If rebuilding fails, queries do not use the index until the next batch.
+     * @return true, if the index is available and must be released with release_st_index() after the query,
+     * false if the index is not available
+     */
+    bool prepare_st_index();
+    void release_st_index();
+
+    /**
+     * Number of total changes on the database connection after the spatiotemporal index has been built,
+     * -1 if no index has been built yet, -2 if the R*Tree module is not available
+     */
+    int64_t _st_index_changes;
+    int64_t _st_index_data_version;
+    int64_t _st_index_batch;         // query batch of the last check for modifications by other connections
+    int64_t _st_index_failed_batch;  // query batch of the last failed attempt to build the index
+    uint32_t _st_index_readers;      // number of running queries using the index
+    std::mutex _st_index_mutex;
+    std::condition_variable _st_index_cv;
+    static std::atomic<int64_t> _query_batch;
+
+    /**
+     * Get a prepared statement for the given SQL query, either from the cache or newly prepared. Statements must be given
+     * back with release_cached_statement() after use, such that they can be reused e.g. for subsequent chunks. Every statement
+     * is used by at most one thread at a time.
+     */
+    sqlite3_stmt* get_cached_statement(std::string sql);
+    void release_cached_statement(std::string sql, sqlite3_stmt* stmt);
+
+    std::map<std::string, std::vector<sqlite3_stmt*>> _stmt_cache;
+    std::mutex _stmt_cache_mutex;
+
     static std::string sqlite_as_string(sqlite3_stmt* stmt, uint16_t col);
 
 
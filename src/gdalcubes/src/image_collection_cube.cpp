@@ -25,25 +25,29 @@
 
 #include <gdal_utils.h>
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <map>
 #include <unordered_map>
 
+#include "dataset_pool.h"
 #include "error.h"
 #include "utils.h"
 #include "warp.h"
 
 namespace gdalcubes {
 
-image_collection_cube::image_collection_cube(std::shared_ptr<image_collection> ic, cube_view v) : cube(std::make_shared<cube_view>(v)), _collection(ic), _input_bands(), _mask(nullptr), _mask_band(""), _strict(true) { load_bands(); }
-image_collection_cube::image_collection_cube(std::string icfile, cube_view v) : cube(std::make_shared<cube_view>(v)), _collection(std::make_shared<image_collection>(icfile)), _input_bands(), _mask(nullptr), _mask_band(""), _strict(true) { load_bands(); }
-image_collection_cube::image_collection_cube(std::shared_ptr<image_collection> ic, std::string vfile) : cube(std::make_shared<cube_view>(cube_view::read_json(vfile))), _collection(ic), _input_bands(), _mask(nullptr), _mask_band(""), _strict(true) { load_bands(); }
-image_collection_cube::image_collection_cube(std::string icfile, std::string vfile) : cube(std::make_shared<cube_view>(cube_view::read_json(vfile))), _collection(std::make_shared<image_collection>(icfile)), _input_bands(), _mask(nullptr), _mask_band(""), _strict(true) { load_bands(); }
-image_collection_cube::image_collection_cube(std::shared_ptr<image_collection> ic) : cube(), _collection(ic), _input_bands(), _mask(nullptr), _mask_band(""), _strict(true) {
+image_collection_cube::image_collection_cube(std::shared_ptr<image_collection> ic, cube_view v) : cube(std::make_shared<cube_view>(v)), _collection(ic), _input_bands(), _mask(nullptr), _mask_band(""), _strict(true), _use_plan(true), _plan_mutex(), _plan(nullptr), _srs_mutex(), _srs_same() { load_bands(); }
+image_collection_cube::image_collection_cube(std::string icfile, cube_view v) : cube(std::make_shared<cube_view>(v)), _collection(std::make_shared<image_collection>(icfile)), _input_bands(), _mask(nullptr), _mask_band(""), _strict(true), _use_plan(true), _plan_mutex(), _plan(nullptr), _srs_mutex(), _srs_same() { load_bands(); }
+image_collection_cube::image_collection_cube(std::shared_ptr<image_collection> ic, std::string vfile) : cube(std::make_shared<cube_view>(cube_view::read_json(vfile))), _collection(ic), _input_bands(), _mask(nullptr), _mask_band(""), _strict(true), _use_plan(true), _plan_mutex(), _plan(nullptr), _srs_mutex(), _srs_same() { load_bands(); }
+image_collection_cube::image_collection_cube(std::string icfile, std::string vfile) : cube(std::make_shared<cube_view>(cube_view::read_json(vfile))), _collection(std::make_shared<image_collection>(icfile)), _input_bands(), _mask(nullptr), _mask_band(""), _strict(true), _use_plan(true), _plan_mutex(), _plan(nullptr), _srs_mutex(), _srs_same() { load_bands(); }
+image_collection_cube::image_collection_cube(std::shared_ptr<image_collection> ic) : cube(), _collection(ic), _input_bands(), _mask(nullptr), _mask_band(""), _strict(true), _use_plan(true), _plan_mutex(), _plan(nullptr), _srs_mutex(), _srs_same() {
     st_reference(std::make_shared<cube_view>(image_collection_cube::default_view(_collection)));
     load_bands();
 }
 
-image_collection_cube::image_collection_cube(std::string icfile) : cube(), _collection(std::make_shared<image_collection>(icfile)), _input_bands(), _mask(nullptr), _mask_band(""), _strict(true) {
+image_collection_cube::image_collection_cube(std::string icfile) : cube(), _collection(std::make_shared<image_collection>(icfile)), _input_bands(), _mask(nullptr), _mask_band(""), _strict(true), _use_plan(true), _plan_mutex(), _plan(nullptr), _srs_mutex(), _srs_same() {
     st_reference(std::make_shared<cube_view>(image_collection_cube::default_view(_collection)));
     load_bands();
 }
@@ -305,12 +309,285 @@ struct aggregation_state_none : public aggregation_state {
     void finalize(void *buf) override {}
 };
 
+std::vector<int64_t> image_collection_cube::add_plan_rows(chunk_plan &plan, const std::vector<image_collection::find_range_st_row> &rows) {
+    std::unordered_map<std::string, uint32_t> interned;
+    for (uint32_t i = 0; i < plan.strings.size(); ++i) {
+        interned.insert(std::make_pair(plan.strings[i], i));
+    }
+    auto intern = [&plan, &interned](const std::string &str) -> uint32_t {
+        auto it = interned.find(str);
+        if (it != interned.end()) {
+            return it->second;
+        }
+        plan.strings.push_back(str);
+        interned.insert(std::make_pair(str, (uint32_t)(plan.strings.size() - 1)));
+        return plan.strings.size() - 1;
+    };
+
+    std::vector<int64_t> out(rows.size(), -1);
+    for (uint32_t i = 0; i < rows.size(); ++i) {
+        const image_collection::find_range_st_row &r = rows[i];
+        if (!_bands.has(r.band_name) && !(_mask && r.band_name == _mask_band)) {
+            continue;  // band is not read
+        }
+        chunk_plan::row pr;
+        pr.image_id = r.image_id;
+        pr.image_name = intern(r.image_name);
+        pr.descriptor = intern(r.descriptor);
+        pr.datetime = intern(r.datetime);
+        pr.band_name = intern(r.band_name);
+        pr.srs = intern(r.srs);
+        pr.band_num = r.band_num;
+        out[i] = plan.rows.size();
+        plan.rows.push_back(pr);
+    }
+    return out;
+}
+
+std::shared_ptr<const image_collection_cube::chunk_plan> image_collection_cube::build_chunk_plan() {
+    std::shared_ptr<chunk_plan> plan = std::make_shared<chunk_plan>();
+    plan->query_batch = image_collection::query_batch();
+
+    uint32_t nt = count_chunks_t();
+    uint32_t ny = count_chunks_y();
+    uint32_t nx = count_chunks_x();
+
+    // Spatial extent of all chunks in WGS84 and temporal extent as strings, exactly as used in image_collection::find_range_st()
+    std::vector<bounds_2d<double>> tile_extent(ny * nx);
+    bounds_2d<double> total_extent;
+    for (uint32_t cy = 0; cy < ny; ++cy) {
+        for (uint32_t cx = 0; cx < nx; ++cx) {
+            bounds_2d<double> e = bounds_from_chunk(chunk_id_from_coords({0, cy, cx})).s;
+            if (_st_ref->srs() != "EPSG:4326") {
+                e = e.transform(_st_ref->srs(), "EPSG:4326");
+            }
+            tile_extent[cy * nx + cx] = e;
+            if (cy == 0 && cx == 0) {
+                total_extent = e;
+            } else {
+                total_extent.left = std::min(total_extent.left, e.left);
+                total_extent.right = std::max(total_extent.right, e.right);
+                total_extent.bottom = std::min(total_extent.bottom, e.bottom);
+                total_extent.top = std::max(total_extent.top, e.top);
+            }
+        }
+    }
+
+    // Extent of columns and rows of tiles. If columns are ordered from west to east and rows from north to south in WGS84,
+    // which is the case unless the cube crosses the antimeridian or a pole, the range of tiles that may intersect with an
+    // image can be found by binary search.
+    std::vector<double> col_left(nx, DBL_MAX), col_right(nx, -DBL_MAX), row_bottom(ny, DBL_MAX), row_top(ny, -DBL_MAX);
+    for (uint32_t cy = 0; cy < ny; ++cy) {
+        for (uint32_t cx = 0; cx < nx; ++cx) {
+            const bounds_2d<double> &e = tile_extent[cy * nx + cx];
+            col_left[cx] = std::min(col_left[cx], e.left);
+            col_right[cx] = std::max(col_right[cx], e.right);
+            row_bottom[cy] = std::min(row_bottom[cy], e.bottom);
+            row_top[cy] = std::max(row_top[cy], e.top);
+        }
+    }
+    bool ordered = std::is_sorted(col_left.begin(), col_left.end()) && std::is_sorted(col_right.begin(), col_right.end()) &&
+                   std::is_sorted(row_bottom.rbegin(), row_bottom.rend()) && std::is_sorted(row_top.rbegin(), row_top.rend());
+
+    std::vector<std::string> t0_str(nt);
+    std::vector<std::string> t1_str(nt);
+    bounds_st total_range;
+    for (uint32_t ct = 0; ct < nt; ++ct) {
+        bounds_st e = bounds_from_chunk(chunk_id_from_coords({ct, 0, 0}));
+        t0_str[ct] = e.t0.to_string(datetime_unit::SECOND);
+        t1_str[ct] = e.t1.to_string(datetime_unit::SECOND);
+        if (ct == 0) total_range.t0 = e.t0;
+        if (ct == nt - 1) total_range.t1 = e.t1;
+    }
+    total_range.s = total_extent;
+
+    std::vector<image_collection::find_range_st_row> rows = _collection->find_range_st(total_range, "EPSG:4326", std::vector<std::string>(), std::vector<std::string>{"gdalrefs.image_id", "gdalrefs.descriptor"});
+    std::vector<int64_t> plan_rows = add_plan_rows(*plan, rows);
+
+    // collect (chunk, row) pairs, rows of the same image share their extent
+    std::vector<std::pair<chunkid_t, uint32_t>> pairs;
+    std::vector<chunkid_t> cur_chunks;
+    for (uint32_t i = 0; i < rows.size(); ++i) {
+        const image_collection::find_range_st_row &r = rows[i];
+        if (i == 0 || r.image_id != rows[i - 1].image_id) {
+            cur_chunks.clear();
+            uint32_t cx0 = 0, cx1 = nx, cy0 = 0, cy1 = ny;
+            if (ordered) {
+                cx0 = std::partition_point(col_right.begin(), col_right.end(), [&r](double v) { return v < r.left; }) - col_right.begin();
+                cx1 = std::partition_point(col_left.begin(), col_left.end(), [&r](double v) { return v <= r.right; }) - col_left.begin();
+                cy0 = std::partition_point(row_bottom.begin(), row_bottom.end(), [&r](double v) { return v > r.top; }) - row_bottom.begin();
+                cy1 = std::partition_point(row_top.begin(), row_top.end(), [&r](double v) { return v >= r.bottom; }) - row_top.begin();
+            }
+            std::vector<uint32_t> tiles;
+            for (uint32_t cy = cy0; cy < cy1; ++cy) {
+                for (uint32_t cx = cx0; cx < cx1; ++cx) {
+                    const bounds_2d<double> &e = tile_extent[cy * nx + cx];
+                    if (!(r.right < e.left || r.left > e.right || r.bottom > e.top || r.top < e.bottom)) {
+                        tiles.push_back(cy * nx + cx);
+                    }
+                }
+            }
+            // time chunks are ordered, find the first one that ends after the image datetime
+            uint32_t ct = std::lower_bound(t1_str.begin(), t1_str.end(), r.datetime_norm) - t1_str.begin();
+            for (; ct < nt && t0_str[ct] <= r.datetime_norm; ++ct) {
+                for (uint32_t it = 0; it < tiles.size(); ++it) {
+                    cur_chunks.push_back(ct * ny * nx + tiles[it]);
+                }
+            }
+        }
+        if (plan_rows[i] < 0) {
+            continue;
+        }
+        for (uint32_t ic = 0; ic < cur_chunks.size(); ++ic) {
+            pairs.push_back(std::make_pair(cur_chunks[ic], (uint32_t)plan_rows[i]));
+        }
+    }
+
+    // counting sort by chunk id, keeps the order of rows within chunks
+    plan->offsets.resize(count_chunks() + 1, 0);
+    for (uint32_t i = 0; i < pairs.size(); ++i) {
+        ++plan->offsets[pairs[i].first + 1];
+    }
+    for (uint32_t i = 1; i < plan->offsets.size(); ++i) {
+        plan->offsets[i] += plan->offsets[i - 1];
+    }
+    plan->index.resize(pairs.size());
+    std::vector<uint32_t> pos(plan->offsets.begin(), plan->offsets.end() - 1);
+    for (uint32_t i = 0; i < pairs.size(); ++i) {
+        plan->index[pos[pairs[i].first]++] = pairs[i].second;
+    }
+    GCBS_DEBUG("Computed chunk plan with " + std::to_string(plan->rows.size()) + " dataset references for " + std::to_string(count_chunks()) + " chunks");
+    return plan;
+}
+
+image_collection_cube::chunk_datasets image_collection_cube::find_chunk_datasets(chunkid_t id) {
+    if (_use_plan) {
+        std::shared_ptr<const chunk_plan> plan;
+        {
+            // the plan is built once per computation, other threads wait for it
+            std::lock_guard<std::mutex> lock(_plan_mutex);
+            if (!_plan || _plan->query_batch != image_collection::query_batch()) {
+                _plan = build_chunk_plan();
+            }
+            plan = _plan;
+        }
+        return chunk_datasets(plan, plan->offsets[id], plan->offsets[id + 1]);
+    }
+    std::shared_ptr<chunk_plan> plan = std::make_shared<chunk_plan>();
+    plan->query_batch = image_collection::query_batch();
+    add_plan_rows(*plan, _collection->find_range_st(bounds_from_chunk(id), _st_ref->srs(), std::vector<std::string>(), std::vector<std::string>{"gdalrefs.image_id", "gdalrefs.descriptor"}));
+    plan->index.resize(plan->rows.size());
+    for (uint32_t i = 0; i < plan->index.size(); ++i) {
+        plan->index[i] = i;
+    }
+    return chunk_datasets(plan, 0, plan->rows.size());
+}
+
+bool image_collection_cube::is_aligned_with_chunk(GDALDataset *in, std::string src_srs, bounds_2d<double> extent, uint32_t nx, uint32_t ny, int32_t &xoff, int32_t &yoff) {
+    double gt[6];
+    if (in->GetGeoTransform(gt) != CE_None) {
+        return false;  // GCPs, RPCs, or geolocation arrays
+    }
+    if (gt[2] != 0.0 || gt[4] != 0.0 || gt[1] <= 0.0 || gt[5] >= 0.0) {
+        return false;  // rotated or not north-up
+    }
+
+    // pixel size must be equal and pixel boundaries must coincide (with a small tolerance in pixel units)
+    const double eps = 1e-6;
+    double dx = (extent.right - extent.left) / double(nx);
+    double dy = (extent.top - extent.bottom) / double(ny);
+    if (std::fabs(gt[1] - dx) * nx > eps * dx || std::fabs(-gt[5] - dy) * ny > eps * dy) {
+        return false;
+    }
+    double fxoff = (extent.left - gt[0]) / gt[1];
+    double fyoff = (gt[3] - extent.top) / -gt[5];
+    if (std::fabs(fxoff - std::round(fxoff)) > eps || std::fabs(fyoff - std::round(fyoff)) > eps) {
+        return false;
+    }
+    if (std::fabs(fxoff) > INT32_MAX / 2 || std::fabs(fyoff) > INT32_MAX / 2) {
+        return false;
+    }
+
+    if (src_srs.empty()) {
+        src_srs = std::string(in->GetProjectionRef());
+        if (src_srs.empty()) {
+            return false;
+        }
+    }
+    if (src_srs != _st_ref->srs()) {
+        std::lock_guard<std::mutex> lock(_srs_mutex);
+        auto it = _srs_same.find(src_srs);
+        if (it == _srs_same.end()) {
+            OGRSpatialReference srs_in;
+            OGRSpatialReference srs_out;
+            bool same = srs_in.SetFromUserInput(src_srs.c_str()) == OGRERR_NONE &&
+                        srs_out.SetFromUserInput(_st_ref->srs().c_str()) == OGRERR_NONE &&
+                        srs_in.IsSame(&srs_out);
+            it = _srs_same.insert(std::make_pair(src_srs, same)).first;
+        }
+        if (!it->second) {
+            return false;
+        }
+    }
+
+    xoff = (int32_t)std::round(fxoff);
+    yoff = (int32_t)std::round(fyoff);
+    return true;
+}
+
+bool image_collection_cube::read_aligned(GDALDataset *in, std::vector<uint16_t> bands, std::vector<double> nodata, int32_t xoff, int32_t yoff, uint32_t nx, uint32_t ny, std::vector<double *> dst) {
+    // intersection of the chunk with the dataset in dataset pixel coordinates
+    int32_t x0 = std::max(xoff, 0);
+    int32_t y0 = std::max(yoff, 0);
+    int32_t x1 = std::min(xoff + (int32_t)nx, in->GetRasterXSize());
+    int32_t y1 = std::min(yoff + (int32_t)ny, in->GetRasterYSize());
+    if (x1 <= x0 || y1 <= y0) {
+        return true;  // nothing to read
+    }
+    uint32_t wx = x1 - x0;
+    uint32_t wy = y1 - y0;
+
+    for (uint16_t b = 0; b < bands.size(); ++b) {
+        if (!dst[b]) continue;
+        GDALRasterBand *band = in->GetRasterBand(bands[b]);
+        double *p = dst[b] + (y0 - yoff) * nx + (x0 - xoff);
+        CPLErr res = band->RasterIO(GF_Read, x0, y0, wx, wy, p, wx, wy, GDT_Float64, sizeof(double), sizeof(double) * nx, NULL);
+        if (res != CE_None) {
+            return false;
+        }
+
+        // warping ignores source nodata pixels, which then remain NAN in the output
+        bool has_nodata = false;
+        double nd = NAN;
+        if (nodata.size() == 1) {
+            has_nodata = true;
+            nd = nodata[0];
+        } else if (!nodata.empty() && nodata.size() == bands.size()) {
+            has_nodata = true;
+            nd = nodata[b];
+        }
+        if (has_nodata && !std::isnan(nd)) {
+            // compare in single precision for Float32 bands, nodata values from the collection are given as decimal strings
+            bool cmp_float = band->GetRasterDataType() == GDT_Float32;
+            for (uint32_t iy = 0; iy < wy; ++iy) {
+                double *row = p + iy * nx;
+                for (uint32_t ix = 0; ix < wx; ++ix) {
+                    if (row[ix] == nd || (cmp_float && (float)row[ix] == (float)nd)) {
+                        row[ix] = NAN;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
 /*
  * The procedure to read data for a chunk is the following:
  * 1. Exclude images that are completely ouside the spatiotemporal chunk boundaries
- * 2. create a temporary in-memory VRT dataset which crops images at the boundary of the corresponding chunks and selects its bands
- * 3. use gdal warp to reproject the VRT dataset to an in-memory GDAL dataset (this will take most of the time)
- * 4. use RasterIO to read from the dataset
+ * 2. if the pixel grid of a dataset is aligned with the chunk, read the selected bands with windowed RasterIO calls directly
+ * 3. otherwise, use gdal warp to reproject the selected bands to an in-memory GDAL dataset (this will take most of the time)
+ *    and use RasterIO to read from the warped dataset
  */
 std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
     GCBS_TRACE("image_collection_cube::read_chunk(" + std::to_string(id) + ")");
@@ -324,7 +601,7 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
     // Find intersecting images from collection and iterate over these
     // Note that these are ordered by image id and descriptor
     bounds_st cextent = bounds_from_chunk(id);
-    std::vector<image_collection::find_range_st_row> datasets = _collection->find_range_st(cextent, _st_ref->srs(), std::vector<std::string>(), std::vector<std::string>{"gdalrefs.image_id", "gdalrefs.descriptor"});
+    chunk_datasets datasets = find_chunk_datasets(id);
 
     if (datasets.empty()) {
         //GCBS_DEBUG("Chunk " + std::to_string(id) + " does not intersect with any image from the image_collection_cube");
@@ -419,9 +696,7 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
         std::fill((double *)img_buf, ((double *)img_buf) + size_btyx[0] * size_btyx[3] * size_btyx[2], NAN);
 
         for (auto it = image_datasets.begin(); it != image_datasets.end(); ++it) {
-            GDALDataset *bandsel_vrt = nullptr;
-            std::string bandsel_vrt_name = "";
-            GDALDataset *g = (GDALDataset *)GDALOpen(it->first.c_str(), GA_ReadOnly);
+            GDALDataset *g = gdal_dataset_pool::instance()->acquire(it->first);
             if (!g) {
                 GCBS_WARN("GDAL could not open '" + it->first + "':  ERROR (" + std::to_string(CPLGetLastErrorNo()) + "): " + CPLGetLastErrorMsg());
                 if (_strict) {
@@ -439,35 +714,14 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
 
             if (g->GetRasterCount() == 0) {
                 GCBS_DEBUG("GDAL dataset'" + it->first + "' does not contain any raster bands and will be ignored.");
+                gdal_dataset_pool::instance()->release(g);
                 continue;
             }
 
-            // If input dataset has more bands than requested
-            bool create_band_subset_vrt = false;
-            if (g->GetRasterCount() > int(it->second.size())) {
-                create_band_subset_vrt = true;
-                // create temporary VRT dataset
-
-                CPLStringList translate_args;
-                translate_args.AddString("-of");
-                translate_args.AddString("VRT");
-
-                for (uint16_t b = 0; b < it->second.size(); ++b) {
-                    translate_args.AddString("-b");
-                    translate_args.AddString(std::to_string(std::get<1>(it->second[b])).c_str());
-                }
-
-                GDALTranslateOptions *trans_options = GDALTranslateOptionsNew(translate_args.List(), NULL);
-                if (trans_options == NULL) {
-                    GCBS_ERROR("Cannot create gdal_translate options");
-                    throw std::string("Cannot create gdal_translate options");
-                }
-                bandsel_vrt_name = "/vsimem/" + utils::generate_unique_filename() + ".vrt";
-                bandsel_vrt = (GDALDataset *)GDALTranslate(bandsel_vrt_name.c_str(), (GDALDatasetH)g, trans_options, NULL);
-                if (bandsel_vrt == NULL) {
-                    create_band_subset_vrt = false;
-                }
-                GDALTranslateOptionsFree(trans_options);
+            // Bands are selected directly in the warp operation (without an intermediate band subset VRT)
+            std::vector<uint16_t> band_nums;
+            for (uint16_t b = 0; b < it->second.size(); ++b) {
+                band_nums.push_back(std::get<1>(it->second[b]));
             }
 
             std::vector<double> nodata_value_list;
@@ -481,31 +735,64 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
             }
             if (nodata_value_list.empty()) {
                 // try to derive nodata value from gdal dataset
-                GDALDataset *d = (create_band_subset_vrt && bandsel_vrt != nullptr) ? bandsel_vrt : g;
-                for (uint16_t b = 0; b < d->GetRasterCount(); ++b) {
+                for (uint16_t b = 0; b < band_nums.size(); ++b) {
+                    if (band_nums[b] < 1 || band_nums[b] > g->GetRasterCount()) {
+                        break;
+                    }
                     int succ = 0;
-                    double val = d->GetRasterBand(b + 1)->GetNoDataValue(&succ);
+                    double val = g->GetRasterBand(band_nums[b])->GetNoDataValue(&succ);
                     if (succ) {
                         nodata_value_list.push_back(val);
                     }
                 }
-                if ((int)nodata_value_list.size() != d->GetRasterCount()) {
+                if (nodata_value_list.size() != band_nums.size()) {
                     nodata_value_list.clear();
                 }
             }
 
-            GDALDataset *gdal_out = nullptr;
-            if (create_band_subset_vrt && bandsel_vrt != nullptr) {
-                //gdal_out = (GDALDataset *)GDALWarp("", NULL, 1, (GDALDatasetH *)(&bandsel_vrt), warp_opts, NULL);
-                gdal_out = gdalwarp_client::warp(bandsel_vrt, src_srs.c_str(), _st_ref->srs().c_str(), cextent.s.left, cextent.s.right,
-                                                 cextent.s.top, cextent.s.bottom, size_btyx[3], size_btyx[2],
-                                                 resampling::to_string(view()->resampling_method()), nodata_value_list);
-            } else {
-                //gdal_out = (GDALDataset *)GDALWarp("", NULL, 1, (GDALDatasetH *)(&g), warp_opts, NULL);
-                gdal_out = gdalwarp_client::warp(g, src_srs.c_str(), _st_ref->srs().c_str(), cextent.s.left, cextent.s.right,
-                                                 cextent.s.top, cextent.s.bottom, size_btyx[3], size_btyx[2],
-                                                 resampling::to_string(view()->resampling_method()), nodata_value_list);
+            // If the dataset has the same pixel grid as the chunk, read data directly without warping
+            int32_t xoff = 0;
+            int32_t yoff = 0;
+            bool bands_valid = true;
+            for (uint16_t b = 0; b < band_nums.size(); ++b) {
+                if (band_nums[b] < 1 || band_nums[b] > g->GetRasterCount()) bands_valid = false;
             }
+            // without nodata values, gdalwarp respects per-dataset masks, which are not considered in aligned reads
+            if (bands_valid && (!nodata_value_list.empty() || !(g->GetRasterBand(band_nums[0])->GetMaskFlags() & GMF_PER_DATASET)) &&
+                is_aligned_with_chunk(g, src_srs, cextent.s, size_btyx[3], size_btyx[2], xoff, yoff)) {
+                std::vector<double *> dst;
+                for (uint16_t b = 0; b < it->second.size(); ++b) {
+                    uint16_t b_internal = _bands.get_index(std::get<0>(it->second[b]));
+                    // Make sure that b_internal is valid in order to prevent buffer overflows
+                    if (b_internal >= out->size()[0]) {
+                        dst.push_back(nullptr);
+                    } else {
+                        dst.push_back(((double *)img_buf) + b_internal * size_btyx[2] * size_btyx[3]);
+                    }
+                }
+                bool success = read_aligned(g, band_nums, nodata_value_list, xoff, yoff, size_btyx[3], size_btyx[2], dst);
+                gdal_dataset_pool::instance()->release(g);
+                if (!success) {
+                    GCBS_WARN("RasterIO (read) failed for '" + it->first + "':  ERROR (" + std::to_string(CPLGetLastErrorNo()) + "): " + CPLGetLastErrorMsg());
+                    if (_strict) {
+                        if (img_buf) std::free(img_buf);
+                        if (mask_buf) std::free(mask_buf);
+                        delete agg;
+                        out = std::make_shared<chunk_data>();
+                        out->set_status(chunk_data::chunk_status::ERROR);
+                        return out;
+                    }
+                    GCBS_WARN("Dataset '" + it->first + "' will be ignored.");
+                    out->set_status(chunk_data::chunk_status::INCOMPLETE);
+                }
+                continue;
+            }
+
+            GDALDataset *gdal_out = gdalwarp_client::warp(g, src_srs.c_str(), _st_ref->srs().c_str(), cextent.s.left, cextent.s.right,
+                                                          cextent.s.top, cextent.s.bottom, size_btyx[3], size_btyx[2],
+                                                          resampling::to_string(view()->resampling_method()), nodata_value_list, band_nums);
+            // the warped in-memory dataset does not depend on the input dataset
+            gdal_dataset_pool::instance()->release(g);
             if (!gdal_out) {
                 GCBS_WARN("GDAL could not warp '" + it->first + "':  ERROR (" + std::to_string(CPLGetLastErrorNo()) + "): " + CPLGetLastErrorMsg());
                 if (_strict) {
@@ -529,18 +816,15 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
                 if (b_internal < 0 || b_internal >= out->size()[0])
                     continue;
 
-                CPLErr res;
-                if (create_band_subset_vrt) {  // bands have been renumbered / sorted according to order of it->second
-                    res = gdal_out->GetRasterBand(b + 1)->RasterIO(GF_Read, 0, 0, size_btyx[3], size_btyx[2], ((double *)img_buf) + b_internal * size_btyx[2] * size_btyx[3], size_btyx[3], size_btyx[2], GDT_Float64, 0, 0, NULL);
-                } else {
-                    res = gdal_out->GetRasterBand(std::get<1>(it->second[b]))->RasterIO(GF_Read, 0, 0, size_btyx[3], size_btyx[2], ((double *)img_buf) + b_internal * size_btyx[2] * size_btyx[3], size_btyx[3], size_btyx[2], GDT_Float64, 0, 0, NULL);
-                }
+                // bands of the warped dataset are ordered according to it->second
+                CPLErr res = gdal_out->GetRasterBand(b + 1)->RasterIO(GF_Read, 0, 0, size_btyx[3], size_btyx[2], ((double *)img_buf) + b_internal * size_btyx[2] * size_btyx[3], size_btyx[3], size_btyx[2], GDT_Float64, 0, 0, NULL);
                 if (res != CE_None) {
                     GCBS_WARN("RasterIO (read) failed for '" + std::string(gdal_out->GetDescription()) + "':  ERROR (" + std::to_string(CPLGetLastErrorNo()) + "): " + CPLGetLastErrorMsg());
                     if (_strict) {
                         if (img_buf) std::free(img_buf);
                         if (mask_buf) std::free(mask_buf);
                         delete agg;
+                        GDALClose(gdal_out);
                         out = std::make_shared<chunk_data>();
                         out->set_status(chunk_data::chunk_status::ERROR);
                         return out;
@@ -550,9 +834,6 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
                     continue;
                 }
             }
-            if (!bandsel_vrt_name.empty()) {
-                filesystem::remove(bandsel_vrt_name);
-            }
             GDALClose(gdal_out);
         }
 
@@ -565,8 +846,7 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
             if (mask_dataset_band.first.empty()) {
                 GCBS_WARN("Missing mask band for image '" + image_name + "', mask will be ignored");
             } else {
-                GDALDataset *bandsel_vrt = nullptr;
-                GDALDataset *g = (GDALDataset *)GDALOpen(mask_dataset_band.first.c_str(), GA_ReadOnly);
+                GDALDataset *g = gdal_dataset_pool::instance()->acquire(mask_dataset_band.first);
                 if (!g) {
                     GCBS_WARN("GDAL could not open '" + mask_dataset_band.first + "':  ERROR (" + std::to_string(CPLGetLastErrorNo()) + "): " + CPLGetLastErrorMsg());
                     if (_strict) {
@@ -579,75 +859,68 @@ std::shared_ptr<chunk_data> image_collection_cube::read_chunk(chunkid_t id) {
                     continue;
                 }
                 else {
-                    // If input dataset has more bands than requested
-                    bool create_band_subset_vrt = false;
-                    if (g->GetRasterCount() > 1) {
-                        create_band_subset_vrt = true;
-                        // create temporary VRT dataset
-
-                        CPLStringList translate_args;
-                        translate_args.AddString("-of");
-                        translate_args.AddString("VRT");
-
-                        translate_args.AddString("-b");
-                        translate_args.AddString(std::to_string(mask_dataset_band.second).c_str());
-
-                        GDALTranslateOptions *trans_options = GDALTranslateOptionsNew(translate_args.List(), NULL);
-                        if (trans_options == NULL) {
-                            GCBS_ERROR("Cannot create gdal_translate options");
-                            throw std::string("Cannot create gdal_translate options");
+                    // read the mask band directly, if the dataset has the same pixel grid as the chunk
+                    int32_t xoff = 0;
+                    int32_t yoff = 0;
+                    if (mask_dataset_band.second >= 1 && mask_dataset_band.second <= g->GetRasterCount() &&
+                        !(g->GetRasterBand(mask_dataset_band.second)->GetMaskFlags() & GMF_PER_DATASET) &&
+                        is_aligned_with_chunk(g, src_srs, cextent.s, size_btyx[3], size_btyx[2], xoff, yoff)) {
+                        std::fill((double *)mask_buf, ((double *)mask_buf) + size_btyx[3] * size_btyx[2], NAN);
+                        bool success = read_aligned(g, std::vector<uint16_t>{mask_dataset_band.second}, std::vector<double>(), xoff, yoff,
+                                                    size_btyx[3], size_btyx[2], std::vector<double *>{(double *)mask_buf});
+                        gdal_dataset_pool::instance()->release(g);
+                        if (!success) {
+                            GCBS_WARN("RasterIO (read) failed for '" + mask_dataset_band.first + "':  ERROR (" + std::to_string(CPLGetLastErrorNo()) + "): " + CPLGetLastErrorMsg());
+                            if (_strict) {
+                                if (img_buf) std::free(img_buf);
+                                if (mask_buf) std::free(mask_buf);
+                                delete agg;
+                                out = std::make_shared<chunk_data>();
+                                out->set_status(chunk_data::chunk_status::ERROR);
+                                return out;
+                            }
+                            GCBS_WARN("Mask dataset '" + mask_dataset_band.first + "' will be ignored.");
+                            out->set_status(chunk_data::chunk_status::INCOMPLETE);
+                            continue;
                         }
-
-                        bandsel_vrt = (GDALDataset *)GDALTranslate("", (GDALDatasetH)g, trans_options, NULL);
-                        if (bandsel_vrt == NULL) {
-                            create_band_subset_vrt = false;
-                        }
-                        GDALTranslateOptionsFree(trans_options);
-                    }
-
-                    GDALDataset *gdal_out = nullptr;
-                    if (create_band_subset_vrt && bandsel_vrt != nullptr) {
-                        //gdal_out = (GDALDataset *)GDALWarp("", NULL, 1, (GDALDatasetH *)(&bandsel_vrt), warp_opts, NULL);
-                        gdal_out = gdalwarp_client::warp(bandsel_vrt, src_srs.c_str(), _st_ref->srs().c_str(), cextent.s.left, cextent.s.right,
-                                                         cextent.s.top, cextent.s.bottom, size_btyx[3], size_btyx[2],
-                                                         "near", std::vector<double>());
                     } else {
-                        //gdal_out = (GDALDataset *)GDALWarp("", NULL, 1, (GDALDatasetH *)(&g), warp_opts, NULL);
-                        gdal_out = gdalwarp_client::warp(g, src_srs.c_str(), _st_ref->srs().c_str(), cextent.s.left, cextent.s.right,
-                                                         cextent.s.top, cextent.s.bottom, size_btyx[3], size_btyx[2],
-                                                         "near", std::vector<double>());
-                    }
-                    if (!gdal_out) {
-                        GCBS_WARN("GDAL could not warp '" + mask_dataset_band.first + "':  ERROR (" + std::to_string(CPLGetLastErrorNo()) + "): " + CPLGetLastErrorMsg());
-                        if (_strict) {
-                            if (img_buf) std::free(img_buf);
-                            if (mask_buf) std::free(mask_buf);
-                            delete agg;
-                            out = std::make_shared<chunk_data>();
-                            out->set_status(chunk_data::chunk_status::ERROR);
-                            return out;
+                        GDALDataset *gdal_out = gdalwarp_client::warp(g, src_srs.c_str(), _st_ref->srs().c_str(), cextent.s.left, cextent.s.right,
+                                                                      cextent.s.top, cextent.s.bottom, size_btyx[3], size_btyx[2],
+                                                                      "near", std::vector<double>(), std::vector<uint16_t>{mask_dataset_band.second});
+                        gdal_dataset_pool::instance()->release(g);
+                        if (!gdal_out) {
+                            GCBS_WARN("GDAL could not warp '" + mask_dataset_band.first + "':  ERROR (" + std::to_string(CPLGetLastErrorNo()) + "): " + CPLGetLastErrorMsg());
+                            if (_strict) {
+                                if (img_buf) std::free(img_buf);
+                                if (mask_buf) std::free(mask_buf);
+                                delete agg;
+                                out = std::make_shared<chunk_data>();
+                                out->set_status(chunk_data::chunk_status::ERROR);
+                                return out;
+                            }
+                            GCBS_WARN("Mask dataset '" + mask_dataset_band.first + "' will be ignored.");
+                            out->set_status(chunk_data::chunk_status::INCOMPLETE);
+                            continue;
                         }
-                        GCBS_WARN("Mask dataset '" + mask_dataset_band.first + "' will be ignored.");
-                        out->set_status(chunk_data::chunk_status::INCOMPLETE);
-                        continue;
-                    }
-                    CPLErr res = gdal_out->GetRasterBand(mask_dataset_band.second)->RasterIO(GF_Read, 0, 0, size_btyx[3], size_btyx[2], mask_buf, size_btyx[3], size_btyx[2], GDT_Float64, 0, 0, NULL);
-                    
-                    if (res != CE_None) {
-                        GCBS_WARN("RasterIO (read) failed for '" + std::string(gdal_out->GetDescription()) + "':  ERROR (" + std::to_string(CPLGetLastErrorNo()) + "): " + CPLGetLastErrorMsg());
-                        if (_strict) {
-                            if (img_buf) std::free(img_buf);
-                            if (mask_buf) std::free(mask_buf);
-                            delete agg;
-                            out = std::make_shared<chunk_data>();
-                            out->set_status(chunk_data::chunk_status::ERROR);
-                            return out;
+                        CPLErr res = gdal_out->GetRasterBand(1)->RasterIO(GF_Read, 0, 0, size_btyx[3], size_btyx[2], mask_buf, size_btyx[3], size_btyx[2], GDT_Float64, 0, 0, NULL);
+
+                        if (res != CE_None) {
+                            GCBS_WARN("RasterIO (read) failed for '" + std::string(gdal_out->GetDescription()) + "':  ERROR (" + std::to_string(CPLGetLastErrorNo()) + "): " + CPLGetLastErrorMsg());
+                            GDALClose(gdal_out);
+                            if (_strict) {
+                                if (img_buf) std::free(img_buf);
+                                if (mask_buf) std::free(mask_buf);
+                                delete agg;
+                                out = std::make_shared<chunk_data>();
+                                out->set_status(chunk_data::chunk_status::ERROR);
+                                return out;
+                            }
+                            GCBS_WARN("Mask dataset '" + mask_dataset_band.first + "' will be ignored.");
+                            out->set_status(chunk_data::chunk_status::INCOMPLETE);
+                            continue;
                         }
-                        GCBS_WARN("Mask dataset '" + mask_dataset_band.first + "' will be ignored.");
-                        out->set_status(chunk_data::chunk_status::INCOMPLETE);
-                        continue;
+                        GDALClose(gdal_out);
                     }
-                    GDALClose(gdal_out);
                     _mask->apply((double *)mask_buf, (double *)img_buf, size_btyx[0], size_btyx[2], size_btyx[3]);
                 }
             }
@@ -762,6 +1035,7 @@ cube_view image_collection_cube::default_view(std::shared_ptr<image_collection>
 }
 
 void image_collection_cube::select_bands(std::vector<std::string> bands) {
+    reset_chunk_plan();
     if (bands.empty()) {
         load_bands();  // restore band selection from original image collection
         return;
@@ -782,6 +1056,7 @@ void image_collection_cube::select_bands(std::vector<std::string> bands) {
 }
 
 void image_collection_cube::select_bands(std::vector<uint16_t> bands) {
+    reset_chunk_plan();
     if (bands.empty()) {
         load_bands();  // restore band selection from original image collection
         return;
@@ -24,6 +24,9 @@
 #ifndef IMAGE_COLLECTION_CUBE_H
 #define IMAGE_COLLECTION_CUBE_H
 
+#include <gdal_priv.h>
+
+#include <unordered_map>
 #include <unordered_set>
 
 #include "cube.h"
@@ -272,6 +275,7 @@ class image_collection_cube : public cube {
             if (bands[ib].name == band) {
                 _mask = mask;
                 _mask_band = band;
+                reset_chunk_plan();
                 return;
             }
         }
@@ -284,6 +288,20 @@ class image_collection_cube : public cube {
     // This is important for e.g. streaming.
     void set_chunk_size(uint32_t t, uint32_t y, uint32_t x) {
         _chunk_size = {t, y, x};
+        reset_chunk_plan();
+    }
+
+    /**
+     * @brief Enable or disable the precomputed chunk plan
+     *
+     * If enabled (the default), the assignment of images to chunks is computed with a single query when the first chunk
+     * of a computation is read, such that reading further chunks does not need to query the image collection database.
+     * The plan is rebuilt for each computation (see image_collection::next_query_batch()), such that changes of the
+     * image collection are taken into account.
+     * @param use_plan true to use the plan, false to query the image collection for each chunk individually
+     */
+    void set_use_chunk_plan(bool use_plan) {
+        _use_plan = use_plan;
     }
 
     void set_strict(bool s) {
@@ -321,6 +339,117 @@ class image_collection_cube : public cube {
     std::string _mask_band;
 
     bool _strict;
+
+    /**
+     * Chunk plan, i.e. for all chunks, the list of intersecting GDAL dataset references.
+     * Only references to bands read by the cube (including the mask band) are stored. Strings such as descriptors and
+     * SRS definitions are interned, i.e. each row stores indexes into strings.
+     * The plan is stored in compressed sparse row format: rows of chunk i are rows[index[j]] for
+     * j in [offsets[i], offsets[i+1]), ordered by image id and descriptor. The plan is not modified after it has been
+     * built and hence can be read by multiple threads without locking.
+     */
+    struct chunk_plan {
+        struct row {
+            uint32_t image_id;
+            uint32_t image_name;
+            uint32_t descriptor;
+            uint32_t datetime;
+            uint32_t band_name;
+            uint32_t srs;
+            uint16_t band_num;
+        };
+        int64_t query_batch;  // see image_collection::next_query_batch()
+        std::vector<std::string> strings;
+        std::vector<row> rows;
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> index;
+    };
+
+    /**
+     * Reference to a GDAL dataset band as stored in a chunk plan, valid as long as the plan exists
+     */
+    struct dataset_ref {
+        uint32_t image_id;
+        const std::string &image_name;
+        const std::string &descriptor;
+        const std::string &datetime;
+        const std::string &band_name;
+        uint16_t band_num;
+        const std::string &srs;
+    };
+
+    /**
+     * GDAL dataset references of a single chunk, pointing into a chunk plan
+     */
+    class chunk_datasets {
+       public:
+        chunk_datasets(std::shared_ptr<const chunk_plan> plan, uint32_t begin, uint32_t end) : _plan(plan), _begin(begin), _end(end) {}
+
+        inline std::size_t size() const { return _end - _begin; }
+        inline bool empty() const { return _end == _begin; }
+        inline dataset_ref operator[](std::size_t i) const {
+            const chunk_plan::row &r = _plan->rows[_plan->index[_begin + i]];
+            const std::vector<std::string> &str = _plan->strings;
+            return dataset_ref{r.image_id, str[r.image_name], str[r.descriptor], str[r.datetime], str[r.band_name], r.band_num, str[r.srs]};
+        }
+
+       private:
+        std::shared_ptr<const chunk_plan> _plan;
+        uint32_t _begin;
+        uint32_t _end;
+    };
+
+    /**
+     * Add rows of bands that are read by the cube to a chunk plan, returns for each input row the index of the
+     * corresponding plan row, or -1 if the row has been skipped
+     */
+    std::vector<int64_t> add_plan_rows(chunk_plan &plan, const std::vector<image_collection::find_range_st_row> &rows);
+
+    std::shared_ptr<const chunk_plan> build_chunk_plan();
+
+    void reset_chunk_plan() {
+        std::lock_guard<std::mutex> lock(_plan_mutex);
+        _plan = nullptr;
+    }
+
+    chunk_datasets find_chunk_datasets(chunkid_t id);
+
+    /**
+     * Check whether the pixel grid of a GDAL dataset is aligned with the pixel grid of a chunk, i.e., whether both have
+     * the same spatial reference system and pixel size and pixel boundaries coincide. Data of aligned datasets can be read
+     * directly, without warping.
+     * @param in GDAL dataset
+     * @param src_srs spatial reference system of the dataset as stored in the image collection, if empty, the SRS is read from the dataset
+     * @param extent spatial extent of the chunk
+     * @param nx number of pixels of the chunk in x direction
+     * @param ny number of pixels of the chunk in y direction
+     * @param[out] xoff pixel offset of the upper left chunk pixel in the dataset in x direction, may be negative
+     * @param[out] yoff pixel offset of the upper left chunk pixel in the dataset in y direction, may be negative
+     * @return true if the dataset is aligned with the chunk
+     */
+    bool is_aligned_with_chunk(GDALDataset *in, std::string src_srs, bounds_2d<double> extent, uint32_t nx, uint32_t ny, int32_t &xoff, int32_t &yoff);
+
+    /**
+     * Read bands of a dataset that is aligned with a chunk (see is_aligned_with_chunk()) with one windowed RasterIO call per band.
+     * Source pixels equal to the nodata value are set to NAN, pixels outside the dataset are left unchanged.
+     * @param in GDAL dataset
+     * @param bands 1-based band numbers of the dataset
+     * @param nodata nodata values, either one value for all bands, one value per band, or empty
+     * @param xoff pixel offset as returned by is_aligned_with_chunk()
+     * @param yoff pixel offset as returned by is_aligned_with_chunk()
+     * @param nx number of pixels of the chunk in x direction
+     * @param ny number of pixels of the chunk in y direction
+     * @param dst one ny x nx target buffer per band, nullptr entries will be skipped
+     * @return false if reading one of the bands failed
+     */
+    bool read_aligned(GDALDataset *in, std::vector<uint16_t> bands, std::vector<double> nodata, int32_t xoff, int32_t yoff, uint32_t nx, uint32_t ny, std::vector<double *> dst);
+
+    bool _use_plan;
+    std::mutex _plan_mutex;
+    std::shared_ptr<const chunk_plan> _plan;
+
+    std::mutex _srs_mutex;
+    std::unordered_map<std::string, bool> _srs_same;  // source SRS -> equal to cube SRS?
 };
 
 }  // namespace gdalcubes
@@ -0,0 +1,346 @@
+/*
+    MIT License
+
+    Copyright (c) 2026 Marius Appel <marius.appel@hs-bochum.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "nan_kernels.h"
+
+#include <cmath>
+
+#if !defined(GDALCUBES_NO_SIMD) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define GDALCUBES_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace gdalcubes {
+
+namespace {
+
+/*
+ * Scalar implementations, also used for the remainder of vectorized loops
+ */
+
+void sum_scalar(const double* x, double* acc, uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        if (!std::isnan(x[i])) acc[i] += x[i];
+    }
+}
+
+void sum_count_scalar(const double* x, double* acc, double* count, uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        if (!std::isnan(x[i])) {
+            acc[i] += x[i];
+            count[i] += 1;
+        }
+    }
+}
+
+void prod_scalar(const double* x, double* acc, uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        if (!std::isnan(x[i])) acc[i] *= x[i];
+    }
+}
+
+void count_scalar(const double* x, double* count, uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        if (!std::isnan(x[i])) count[i] += 1;
+    }
+}
+
+void min_scalar(const double* x, double* acc, uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        if (!std::isnan(x[i]) && (std::isnan(acc[i]) || x[i] < acc[i])) acc[i] = x[i];
+    }
+}
+
+void max_scalar(const double* x, double* acc, uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        if (!std::isnan(x[i]) && (std::isnan(acc[i]) || x[i] > acc[i])) acc[i] = x[i];
+    }
+}
+
+void welford_scalar(const double* x, double* mean, double* m2, double* count, uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        if (!std::isnan(x[i])) {
+            count[i] += 1;
+            double delta = x[i] - mean[i];
+            mean[i] += delta / count[i];
+            m2[i] += delta * (x[i] - mean[i]);
+        }
+    }
+}
+
+#ifdef GDALCUBES_SIMD_X86
+
+/*
+ * SSE2 implementations, SSE2 is part of the x86-64 baseline
+ */
+
+inline __m128d blend_sse2(__m128d a, __m128d b, __m128d mask) {
+    return _mm_or_pd(_mm_and_pd(mask, b), _mm_andnot_pd(mask, a));
+}
+
+void sum_sse2(const double* x, double* acc, uint32_t n) {
+    uint32_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(x + i);
+        __m128d a = _mm_loadu_pd(acc + i);
+        __m128d valid = _mm_cmpord_pd(v, v);
+        _mm_storeu_pd(acc + i, _mm_add_pd(a, _mm_and_pd(valid, v)));
+    }
+    sum_scalar(x + i, acc + i, n - i);
+}
+
+void sum_count_sse2(const double* x, double* acc, double* count, uint32_t n) {
+    const __m128d one = _mm_set1_pd(1.0);
+    uint32_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(x + i);
+        __m128d valid = _mm_cmpord_pd(v, v);
+        _mm_storeu_pd(acc + i, _mm_add_pd(_mm_loadu_pd(acc + i), _mm_and_pd(valid, v)));
+        _mm_storeu_pd(count + i, _mm_add_pd(_mm_loadu_pd(count + i), _mm_and_pd(valid, one)));
+    }
+    sum_count_scalar(x + i, acc + i, count + i, n - i);
+}
+
+void prod_sse2(const double* x, double* acc, uint32_t n) {
+    uint32_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(x + i);
+        __m128d a = _mm_loadu_pd(acc + i);
+        __m128d valid = _mm_cmpord_pd(v, v);
+        _mm_storeu_pd(acc + i, blend_sse2(a, _mm_mul_pd(a, v), valid));
+    }
+    prod_scalar(x + i, acc + i, n - i);
+}
+
+void count_sse2(const double* x, double* count, uint32_t n) {
+    const __m128d one = _mm_set1_pd(1.0);
+    uint32_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(x + i);
+        __m128d valid = _mm_cmpord_pd(v, v);
+        _mm_storeu_pd(count + i, _mm_add_pd(_mm_loadu_pd(count + i), _mm_and_pd(valid, one)));
+    }
+    count_scalar(x + i, count + i, n - i);
+}
+
+void min_sse2(const double* x, double* acc, uint32_t n) {
+    uint32_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(x + i);
+        __m128d a = _mm_loadu_pd(acc + i);
+        // _mm_min_pd(v, a) returns a if any of both is NAN
+        __m128d r = blend_sse2(_mm_min_pd(v, a), v, _mm_cmpunord_pd(a, a));
+        _mm_storeu_pd(acc + i, r);
+    }
+    min_scalar(x + i, acc + i, n - i);
+}
+
+void max_sse2(const double* x, double* acc, uint32_t n) {
+    uint32_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(x + i);
+        __m128d a = _mm_loadu_pd(acc + i);
+        __m128d r = blend_sse2(_mm_max_pd(v, a), v, _mm_cmpunord_pd(a, a));
+        _mm_storeu_pd(acc + i, r);
+    }
+    max_scalar(x + i, acc + i, n - i);
+}
+
+void welford_sse2(const double* x, double* mean, double* m2, double* count, uint32_t n) {
+    const __m128d one = _mm_set1_pd(1.0);
+    uint32_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(x + i);
+        __m128d valid = _mm_cmpord_pd(v, v);
+        __m128d c = _mm_add_pd(_mm_loadu_pd(count + i), _mm_and_pd(valid, one));
+        __m128d m = _mm_loadu_pd(mean + i);
+        __m128d s = _mm_loadu_pd(m2 + i);
+        __m128d delta = _mm_sub_pd(v, m);
+        __m128d m_new = _mm_add_pd(m, _mm_div_pd(delta, c));
+        __m128d s_new = _mm_add_pd(s, _mm_mul_pd(delta, _mm_sub_pd(v, m_new)));
+        _mm_storeu_pd(count + i, c);
+        _mm_storeu_pd(mean + i, blend_sse2(m, m_new, valid));
+        _mm_storeu_pd(m2 + i, blend_sse2(s, s_new, valid));
+    }
+    welford_scalar(x + i, mean + i, m2 + i, count + i, n - i);
+}
+
+/*
+ * AVX2 implementations, only called if supported by the CPU
+ */
+
+#define GDALCUBES_TARGET_AVX2 __attribute__((target("avx2")))
+
+GDALCUBES_TARGET_AVX2 void sum_avx2(const double* x, double* acc, uint32_t n) {
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(x + i);
+        __m256d a = _mm256_loadu_pd(acc + i);
+        __m256d valid = _mm256_cmp_pd(v, v, _CMP_ORD_Q);
+        _mm256_storeu_pd(acc + i, _mm256_add_pd(a, _mm256_and_pd(valid, v)));
+    }
+    sum_scalar(x + i, acc + i, n - i);
+}
+
+GDALCUBES_TARGET_AVX2 void sum_count_avx2(const double* x, double* acc, double* count, uint32_t n) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(x + i);
+        __m256d valid = _mm256_cmp_pd(v, v, _CMP_ORD_Q);
+        _mm256_storeu_pd(acc + i, _mm256_add_pd(_mm256_loadu_pd(acc + i), _mm256_and_pd(valid, v)));
+        _mm256_storeu_pd(count + i, _mm256_add_pd(_mm256_loadu_pd(count + i), _mm256_and_pd(valid, one)));
+    }
+    sum_count_scalar(x + i, acc + i, count + i, n - i);
+}
+
+GDALCUBES_TARGET_AVX2 void prod_avx2(const double* x, double* acc, uint32_t n) {
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(x + i);
+        __m256d a = _mm256_loadu_pd(acc + i);
+        __m256d valid = _mm256_cmp_pd(v, v, _CMP_ORD_Q);
+        _mm256_storeu_pd(acc + i, _mm256_blendv_pd(a, _mm256_mul_pd(a, v), valid));
+    }
+    prod_scalar(x + i, acc + i, n - i);
+}
+
+GDALCUBES_TARGET_AVX2 void count_avx2(const double* x, double* count, uint32_t n) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(x + i);
+        __m256d valid = _mm256_cmp_pd(v, v, _CMP_ORD_Q);
+        _mm256_storeu_pd(count + i, _mm256_add_pd(_mm256_loadu_pd(count + i), _mm256_and_pd(valid, one)));
+    }
+    count_scalar(x + i, count + i, n - i);
+}
+
+GDALCUBES_TARGET_AVX2 void min_avx2(const double* x, double* acc, uint32_t n) {
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(x + i);
+        __m256d a = _mm256_loadu_pd(acc + i);
+        // _mm256_min_pd(v, a) returns a if any of both is NAN
+        __m256d r = _mm256_blendv_pd(_mm256_min_pd(v, a), v, _mm256_cmp_pd(a, a, _CMP_UNORD_Q));
+        _mm256_storeu_pd(acc + i, r);
+    }
+    min_scalar(x + i, acc + i, n - i);
+}
+
+GDALCUBES_TARGET_AVX2 void max_avx2(const double* x, double* acc, uint32_t n) {
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(x + i);
+        __m256d a = _mm256_loadu_pd(acc + i);
+        __m256d r = _mm256_blendv_pd(_mm256_max_pd(v, a), v, _mm256_cmp_pd(a, a, _CMP_UNORD_Q));
+        _mm256_storeu_pd(acc + i, r);
+    }
+    max_scalar(x + i, acc + i, n - i);
+}
+
+GDALCUBES_TARGET_AVX2 void welford_avx2(const double* x, double* mean, double* m2, double* count, uint32_t n) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(x + i);
+        __m256d valid = _mm256_cmp_pd(v, v, _CMP_ORD_Q);
+        __m256d c = _mm256_add_pd(_mm256_loadu_pd(count + i), _mm256_and_pd(valid, one));
+        __m256d m = _mm256_loadu_pd(mean + i);
+        __m256d s = _mm256_loadu_pd(m2 + i);
+        __m256d delta = _mm256_sub_pd(v, m);
+        __m256d m_new = _mm256_add_pd(m, _mm256_div_pd(delta, c));
+        __m256d s_new = _mm256_add_pd(s, _mm256_mul_pd(delta, _mm256_sub_pd(v, m_new)));
+        _mm256_storeu_pd(count + i, c);
+        _mm256_storeu_pd(mean + i, _mm256_blendv_pd(m, m_new, valid));
+        _mm256_storeu_pd(m2 + i, _mm256_blendv_pd(s, s_new, valid));
+    }
+    welford_scalar(x + i, mean + i, m2 + i, count + i, n - i);
+}
+
+#endif
+
+struct kernel_table {
+    void (*sum)(const double*, double*, uint32_t);
+    void (*sum_count)(const double*, double*, double*, uint32_t);
+    void (*prod)(const double*, double*, uint32_t);
+    void (*count)(const double*, double*, uint32_t);
+    void (*min)(const double*, double*, uint32_t);
+    void (*max)(const double*, double*, uint32_t);
+    void (*welford)(const double*, double*, double*, double*, uint32_t);
+    const char* level;
+};
+
+kernel_table select_kernels() {
+#ifdef GDALCUBES_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {sum_avx2, sum_count_avx2, prod_avx2, count_avx2, min_avx2, max_avx2, welford_avx2, "avx2"};
+    }
+    return {sum_sse2, sum_count_sse2, prod_sse2, count_sse2, min_sse2, max_sse2, welford_sse2, "sse2"};
+#else
+    return {sum_scalar, sum_count_scalar, prod_scalar, count_scalar, min_scalar, max_scalar, welford_scalar, "scalar"};
+#endif
+}
+
+const kernel_table& kernels() {
+    static const kernel_table k = select_kernels();
+    return k;
+}
+
+}  // namespace
+
+void nan_kernels::sum(const double* x, double* acc, uint32_t n) {
+    kernels().sum(x, acc, n);
+}
+
+void nan_kernels::sum_count(const double* x, double* acc, double* count, uint32_t n) {
+    kernels().sum_count(x, acc, count, n);
+}
+
+void nan_kernels::prod(const double* x, double* acc, uint32_t n) {
+    kernels().prod(x, acc, n);
+}
+
+void nan_kernels::count(const double* x, double* count, uint32_t n) {
+    kernels().count(x, count, n);
+}
+
+void nan_kernels::min(const double* x, double* acc, uint32_t n) {
+    kernels().min(x, acc, n);
+}
+
+void nan_kernels::max(const double* x, double* acc, uint32_t n) {
+    kernels().max(x, acc, n);
+}
+
+void nan_kernels::welford(const double* x, double* mean, double* m2, double* count, uint32_t n) {
+    kernels().welford(x, mean, m2, count, n);
+}
+
+std::string nan_kernels::simd_level() {
+    return kernels().level;
+}
+
+}  // namespace gdalcubes
@@ -0,0 +1,90 @@
+/*
+    MIT License
+
+    Copyright (c) 2026 Marius Appel <marius.appel@hs-bochum.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef NAN_KERNELS_H
+#define NAN_KERNELS_H
+
+#include <cstdint>
+#include <string>
+
+namespace gdalcubes {
+
+/**
+ * @brief Vectorized kernels for reducers that ignore NAN values
+ *
+ * All kernels update n accumulator values with n input values, where input values that are NAN are skipped.
+ * Accumulators and input arrays must not overlap. Depending on the CPU, AVX2 or SSE2 implementations are
+ * selected at runtime on x86-64 systems; on other systems, or if GDALCUBES_NO_SIMD is defined, portable scalar
+ * implementations are used. All implementations give identical results.
+ */
+class nan_kernels {
+   public:
+    /**
+     * @brief acc[i] += x[i]
+     */
+    static void sum(const double* x, double* acc, uint32_t n);
+
+    /**
+     * @brief acc[i] += x[i] and count[i] += 1
+     */
+    static void sum_count(const double* x, double* acc, double* count, uint32_t n);
+
+    /**
+     * @brief acc[i] *= x[i]
+     */
+    static void prod(const double* x, double* acc, uint32_t n);
+
+    /**
+     * @brief count[i] += 1
+     */
+    static void count(const double* x, double* count, uint32_t n);
+
+    /**
+     * @brief acc[i] = min(acc[i], x[i]), where acc[i] is replaced if it is NAN
+     */
+    static void min(const double* x, double* acc, uint32_t n);
+
+    /**
+     * @brief acc[i] = max(acc[i], x[i]), where acc[i] is replaced if it is NAN
+     */
+    static void max(const double* x, double* acc, uint32_t n);
+
+    /**
+     * @brief Update of running means and sums of squared differences with Welford's online algorithm
+     * @param x input values
+     * @param mean running means
+     * @param m2 running sums of squared differences from the mean
+     * @param count number of values
+     * @param n number of pixels
+     */
+    static void welford(const double* x, double* mean, double* m2, double* count, uint32_t n);
+
+    /**
+     * @brief Name of the selected implementation, "avx2", "sse2", or "scalar"
+     */
+    static std::string simd_level();
+};
+
+}  // namespace gdalcubes
+
+#endif  //NAN_KERNELS_H
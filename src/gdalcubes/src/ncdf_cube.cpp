@@ -26,6 +26,7 @@
 #include <netcdf.h>
 
 #include "filesystem.h"
+#include "pack_kernels.h"
 
 namespace gdalcubes {
 
@@ -52,12 +53,14 @@ std::string ncdf_attr_to_string(int ncid, int varid, std::string attr_name) {
     return out;
 }
 
-ncdf_cube::ncdf_cube(std::string path, bool auto_unpack) : cube(), _auto_unpack(auto_unpack), _path({path}), _orig_bands(), _band_selection(), _mutex() {
+ncdf_cube::ncdf_cube(std::string path, bool auto_unpack) : cube(), _auto_unpack(auto_unpack), _path({path}), _orig_bands(), _band_selection(), _ncfile(-1), _chunk_status_varid(-1), _vars() {
     if (!filesystem::is_regular_file(path)) {
         GCBS_ERROR("NetCDF file '" + path + "' does not exist or is not a file");
         throw std::string("NetCDF file '" + path + "' does not exist or is not a file");
     }
 
+    std::lock_guard<std::mutex> lock(nc_mutex());
+
     // Open file
     int ncfile;
     int retval = nc_open(path.c_str(), NC_NOWRITE, &ncfile);
@@ -454,6 +457,81 @@ ncdf_cube::ncdf_cube(std::string path, bool auto_unpack) : cube(), _auto_unpack(
     }
 }
 
+ncdf_cube::~ncdf_cube() {
+    std::lock_guard<std::mutex> lock(nc_mutex());
+    close_file();
+}
+
+std::mutex &ncdf_cube::nc_mutex() {
+    // never destroyed, cubes might be released after static destruction
+    static std::mutex *m = new std::mutex();
+    return *m;
+}
+
+std::set<ncdf_cube *> &ncdf_cube::open_cubes() {
+    static std::set<ncdf_cube *> *c = new std::set<ncdf_cube *>();
+    return *c;
+}
+
+void ncdf_cube::open_file() {
+    if (_ncfile >= 0) return;
+
+    int retval = nc_open(_path.c_str(), NC_NOWRITE, &_ncfile);
+    if (retval != NC_NOERR) {
+        _ncfile = -1;
+        GCBS_ERROR("Failed to open netCDF file '" + _path + "'; nc_open() returned " + std::to_string(retval));
+        throw std::string("Failed to open netCDF file '" + _path + "'; nc_open() returned " + std::to_string(retval));
+    }
+    open_cubes().insert(this);
+
+    // Variables are looked up once per opened file instead of once per chunk and band
+    _vars.clear();
+    for (uint16_t i = 0; i < _orig_bands.count(); ++i) {
+        nc_var var;
+        find_var(_orig_bands.get(i).name, var);
+    }
+    if (nc_inq_varid(_ncfile, "chunk_status", &_chunk_status_varid) != NC_NOERR) {
+        GCBS_DEBUG("NetCDF input file does not contain chunk status data. ");
+        _chunk_status_varid = -1;
+    }
+}
+
+void ncdf_cube::close_file() {
+    if (_ncfile < 0) return;
+    int retval = nc_close(_ncfile);
+    if (retval != NC_NOERR) {
+        GCBS_DEBUG("Failed to properly close netCDF file '" + _path + "'; nc_close() returned " + std::to_string(retval));
+    }
+    _ncfile = -1;
+    _chunk_status_varid = -1;
+    _vars.clear();
+    open_cubes().erase(this);
+}
+
+bool ncdf_cube::find_var(const std::string &name, nc_var &var) {
+    auto it = _vars.find(name);
+    if (it != _vars.end()) {
+        var = it->second;
+        return true;
+    }
+    nc_type type;
+    if (nc_inq_varid(_ncfile, name.c_str(), &var.id) != NC_NOERR ||
+        nc_inq_vartype(_ncfile, var.id, &type) != NC_NOERR) {
+        return false;
+    }
+    var.type = type;
+    _vars[name] = var;
+    return true;
+}
+
+void ncdf_cube::close_files() {
+    std::lock_guard<std::mutex> lock(nc_mutex());
+    // close_file() removes the cube from the set
+    while (!open_cubes().empty()) {
+        (*open_cubes().begin())->close_file();
+    }
+}
+
 std::shared_ptr<chunk_data> ncdf_cube::read_chunk(chunkid_t id) {
     GCBS_TRACE("ncdf_cube::read_chunk(" + std::to_string(id) + ")");
 
@@ -472,67 +550,115 @@ std::shared_ptr<chunk_data> ncdf_cube::read_chunk(chunkid_t id) {
     if (size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3] == 0)
         return out;
 
-    // Fill buffers accordingly
-    out->buf(std::calloc(size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3], sizeof(double)));
-    double *begin = (double *)out->buf();
-    double *end = ((double *)out->buf()) + size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3];
-    std::fill(begin, end, NAN);
+    // Band metadata is fetched once per chunk, _bands.get() returns copies
+    uint32_t nb = size_btyx[0];
+    std::size_t n = std::size_t(size_btyx[1]) * std::size_t(size_btyx[2]) * std::size_t(size_btyx[3]);
+    std::vector<std::string> names(nb);
+    std::vector<double> scale(nb, 1.0);
+    std::vector<double> offset(nb, 0.0);
+    std::vector<double> nodata(nb, NAN);
+    for (uint16_t ib = 0; ib < nb; ++ib) {
+        band b = _bands.get(ib);
+        names[ib] = b.name;
+        if (_auto_unpack) {
+            scale[ib] = b.scale;
+            offset[ib] = b.offset;
+            if (!b.no_data_value.empty()) {
+                nodata[ib] = std::atof(b.no_data_value.c_str());  // TODO ignore if this fails
+            }
+        }
+    }
+
+    out->buf(std::malloc(nb * n * sizeof(double)));
+    double *buf = (double *)out->buf();
 
     bounds_nd<uint32_t, 3> climits = chunk_limits(id);
     std::size_t startp[] = {climits.low[0], climits.low[1], climits.low[2]};
     std::size_t countp[] = {size_btyx[1], size_btyx[2], size_btyx[3]};
 
-    _mutex.lock();
-    // Open file
-    int ncfile;
-    int retval = nc_open(_path.c_str(), NC_NOWRITE, &ncfile);
-    if (retval != NC_NOERR) {
-        GCBS_ERROR("Failed to open netCDF file '" + _path + "'; nc_open() returned " + std::to_string(retval));
-        throw std::string("Failed to open netCDF file '" + _path + "'; nc_open() returned " + std::to_string(retval));
-    }
-
-    int varid = -1;
-    if (nc_inq_varid(ncfile, "chunk_status", &varid) == NC_NOERR) {
-        int s = 0;
-        std::size_t nc_chunk_id = std::size_t(id);
-        nc_get_var1_int(ncfile, varid, &nc_chunk_id, &s);
-        out->set_status(static_cast<chunk_data::chunk_status>(s));
-    }
-    else {
-        GCBS_DEBUG("NetCDF input file does not contain chunk status data. ");
-        out->set_status(chunk_data::chunk_status::UNKNOWN);
-    }
-
-    for (uint16_t i = 0; i < size_btyx[0]; ++i) {
-        if (nc_inq_varid(ncfile, _bands.get(i).name.c_str(), &varid) == NC_NOERR) {
-            nc_get_vara_double(ncfile, varid, startp, countp, (&((double *)(out->buf()))[i * size_btyx[1] * size_btyx[2] * size_btyx[3]]));
+    // Integer and float variables are read in their storage type and converted
+    // outside of the lock, doubles are read directly into the output buffer
+    std::vector<int> types(nb, NC_DOUBLE);
+    std::vector<std::vector<char>> typed_buf(nb);
+    {
+        std::lock_guard<std::mutex> lock(nc_mutex());
+        open_file();
+
+        if (_chunk_status_varid >= 0) {
+            int s = 0;
+            std::size_t nc_chunk_id = std::size_t(id);
+            nc_get_var1_int(_ncfile, _chunk_status_varid, &nc_chunk_id, &s);
+            out->set_status(static_cast<chunk_data::chunk_status>(s));
         } else {
-            GCBS_ERROR("Failed to read band '" + _bands.get(i).name + "' for chunk " + std::to_string(id) + " from netCDF file");
-            throw std::string("Failed to read band '" + _bands.get(i).name + "' for chunk " + std::to_string(id) + " from netCDF file");
+            out->set_status(chunk_data::chunk_status::UNKNOWN);
         }
-    }
-
-    retval = nc_close(ncfile);
-    if (retval != NC_NOERR) {
-        GCBS_DEBUG("Failed to properly close netCDF file '" + _path + "'; nc_close() returned " + std::to_string(retval));
-    }
 
-    _mutex.unlock();
-
-    double nodata = NAN;
-    if (_auto_unpack) {
-        for (uint16_t ib = 0; ib < size_btyx[0]; ++ib) {
-            if (!_bands.get(ib).no_data_value.empty()) {
-                nodata = std::atof(_bands.get(ib).no_data_value.c_str());  // TODO ignore if this fails
-            }
-            for (uint32_t i = 0; i < size_btyx[1] * size_btyx[2] * size_btyx[3]; ++i) {
-                double &v = ((double *)out->buf())[ib * size_btyx[1] * size_btyx[2] * size_btyx[3] + i];
-                if (v == nodata) {
-                    v = NAN;
+        for (uint16_t ib = 0; ib < nb; ++ib) {
+            nc_var var;
+            int retval = NC_ENOTVAR;
+            if (find_var(names[ib], var)) {
+                std::size_t type_size = 0;
+                switch (var.type) {
+                    case NC_BYTE:
+                    case NC_UBYTE:
+                        type_size = 1;
+                        break;
+                    case NC_SHORT:
+                    case NC_USHORT:
+                        type_size = 2;
+                        break;
+                    case NC_INT:
+                    case NC_UINT:
+                    case NC_FLOAT:
+                        type_size = 4;
+                        break;
+                    default:
+                        type_size = 0;
+                }
+                if (type_size > 0) {
+                    types[ib] = var.type;
+                    typed_buf[ib].resize(n * type_size);
+                    retval = nc_get_vara(_ncfile, var.id, startp, countp, typed_buf[ib].data());
                 } else {
-                    v = _bands.get(ib).offset + v * _bands.get(ib).scale;
+                    retval = nc_get_vara_double(_ncfile, var.id, startp, countp, buf + ib * n);
                 }
             }
+            if (retval != NC_NOERR) {
+                GCBS_ERROR("Failed to read band '" + names[ib] + "' for chunk " + std::to_string(id) + " from netCDF file");
+                throw std::string("Failed to read band '" + names[ib] + "' for chunk " + std::to_string(id) + " from netCDF file");
+            }
+        }
+    }
+
+    for (uint16_t ib = 0; ib < nb; ++ib) {
+        double *bandbuf = buf + ib * n;
+        const void *in = typed_buf[ib].data();
+        switch (types[ib]) {
+            case NC_BYTE:
+                pack_kernels::unpack((const int8_t *)in, bandbuf, n, scale[ib], offset[ib], nodata[ib]);
+                break;
+            case NC_UBYTE:
+                pack_kernels::unpack((const uint8_t *)in, bandbuf, n, scale[ib], offset[ib], nodata[ib]);
+                break;
+            case NC_SHORT:
+                pack_kernels::unpack((const int16_t *)in, bandbuf, n, scale[ib], offset[ib], nodata[ib]);
+                break;
+            case NC_USHORT:
+                pack_kernels::unpack((const uint16_t *)in, bandbuf, n, scale[ib], offset[ib], nodata[ib]);
+                break;
+            case NC_INT:
+                pack_kernels::unpack((const int32_t *)in, bandbuf, n, scale[ib], offset[ib], nodata[ib]);
+                break;
+            case NC_UINT:
+                pack_kernels::unpack((const uint32_t *)in, bandbuf, n, scale[ib], offset[ib], nodata[ib]);
+                break;
+            case NC_FLOAT:
+                pack_kernels::unpack((const float *)in, bandbuf, n, scale[ib], offset[ib], nodata[ib]);
+                break;
+            default:
+                if (_auto_unpack) {
+                    pack_kernels::unpack(bandbuf, bandbuf, n, scale[ib], offset[ib], nodata[ib]);
+                }
         }
     }
 
@@ -53,7 +53,7 @@ class ncdf_cube : public cube {
     ncdf_cube(std::string path, bool auto_unpack = true);
 
    public:
-    ~ncdf_cube() {}
+    ~ncdf_cube();
 
     // std::string to_string() override;
 
@@ -85,6 +85,24 @@ class ncdf_cube : public cube {
 
     std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
 
+    /**
+     * @brief Close all netCDF files that have been kept open by ncdf_cube instances
+     *
+     * read_chunk() keeps the file of a cube open across chunks to avoid
+     * repeated nc_open() / nc_close() calls. This function should be called
+     * after computations, e.g. to allow the files to be modified or deleted.
+     * Files are reopened automatically on the next read.
+     */
+    static void close_files();
+
+    /**
+     * @brief Mutex serializing all netCDF library calls within the process
+     *
+     * netCDF is not thread safe, even across different files. Any code calling
+     * nc_* functions, including writing netCDF files, must hold this mutex.
+     */
+    static std::mutex &nc_mutex();
+
     json11::Json make_constructible_json() override {
         json11::Json::object out;
         out["cube_type"] = "ncdf";
@@ -111,7 +129,22 @@ class ncdf_cube : public cube {
     std::string _path;
     band_collection _orig_bands;
     std::vector<std::string> _band_selection;
-    std::mutex _mutex;  // netCDF is not thread safe
+
+    struct nc_var {
+        int id;
+        int type;  // nc_type
+    };
+
+    // Open file handle and variables, only accessed while holding nc_mutex()
+    int _ncfile;
+    int _chunk_status_varid;
+    std::map<std::string, nc_var> _vars;
+
+    void open_file();
+    void close_file();
+    bool find_var(const std::string &name, nc_var &var);
+
+    static std::set<ncdf_cube *> &open_cubes();
 };
 
 }  // namespace gdalcubes
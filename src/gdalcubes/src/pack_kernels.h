@@ -0,0 +1,105 @@
+/*
+    MIT License
+
+    Copyright (c) 2026 Marius Appel <marius.appel@hs-bochum.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef PACK_KERNELS_H
+#define PACK_KERNELS_H
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+namespace gdalcubes {
+
+/**
+ * @brief Kernels for packing and unpacking data values with scale, offset, and nodata values
+ *
+ * Packing converts double values to a (smaller) storage type T as round((v - offset) / scale), where NAN becomes
+ * nodata. Unpacking converts values of type T to double as offset + v * scale, where nodata becomes NAN. Loops
+ * are free of branches and function calls (except std::round) such that compilers can vectorize them. For
+ * floating point storage types, values are not rounded.
+ */
+class pack_kernels {
+   public:
+    /**
+     * @brief Pack n double values from in to out
+     * @param in input values
+     * @param out output values, must not overlap with in unless T is double
+     * @param n number of values
+     * @param scale scale factor
+     * @param offset offset
+     * @param nodata value written for NAN input values
+     */
+    template <typename T>
+    static void pack(const double* in, T* out, std::size_t n, double scale, double offset, double nodata) {
+        pack_impl(in, out, n, scale, offset, nodata, std::is_floating_point<T>());
+    }
+
+    /**
+     * @brief Unpack n values of type T from in to out
+     * @param in input values
+     * @param out output values, may be identical to in if T is double
+     * @param n number of values
+     * @param scale scale factor
+     * @param offset offset
+     * @param nodata input values equal to nodata are set to NAN; if nodata is NAN, no values are replaced
+     */
+    template <typename T>
+    static void unpack(const T* in, double* out, std::size_t n, double scale, double offset, double nodata) {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        if (scale == 1.0 && offset == 0.0) {
+            // plain conversion, keeps e.g. the sign of zero values
+            for (std::size_t i = 0; i < n; ++i) {
+                double v = static_cast<double>(in[i]);
+                out[i] = (v == nodata) ? nan : v;
+            }
+            return;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            double v = static_cast<double>(in[i]);
+            out[i] = (v == nodata) ? nan : offset + v * scale;
+        }
+    }
+
+   private:
+    template <typename T>
+    static void pack_impl(const double* in, T* out, std::size_t n, double scale, double offset, double nodata, std::true_type) {
+        for (std::size_t i = 0; i < n; ++i) {
+            double v = in[i];
+            out[i] = static_cast<T>(std::isnan(v) ? nodata : (v - offset) / scale);
+        }
+    }
+
+    template <typename T>
+    static void pack_impl(const double* in, T* out, std::size_t n, double scale, double offset, double nodata, std::false_type) {
+        for (std::size_t i = 0; i < n; ++i) {
+            double v = in[i];
+            // use std::round to avoid truncation bias
+            out[i] = static_cast<T>(std::isnan(v) ? nodata : std::round((v - offset) / scale));
+        }
+    }
+};
+
+}  // namespace gdalcubes
+
+#endif  // PACK_KERNELS_H
@@ -0,0 +1,214 @@
+/*
+    MIT License
+
+    Copyright (c) 2026 Marius Appel <marius.appel@hs-bochum.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "pixel_expression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "external/tinyexpr/tinyexpr.h"
+
+namespace gdalcubes {
+
+namespace {
+
+// type of constant nodes, not exported from tinyexpr.c
+const int TE_CONSTANT_TYPE = 1;
+
+// operands are encoded as kind << 16 | index while compiling and mapped to slots afterwards
+const uint32_t KIND_VARIABLE = 0;
+const uint32_t KIND_CONSTANT = 1;
+const uint32_t KIND_REGISTER = 2;
+
+}  // namespace
+
+pixel_expression::pixel_expression(std::string expr, std::vector<std::string> vars) : _uses(vars.size(), false), _constants(), _nconstants(0), _nregisters(0), _code(), _result(0) {
+    std::vector<double> values(vars.size(), 1.0);
+    std::vector<te_variable> te_vars;
+    for (uint16_t i = 0; i < vars.size(); ++i) {
+        te_vars.push_back({vars[i].c_str(), &values[i]});
+    }
+    int err = 0;
+    te_expr* root = te_compile(expr.c_str(), te_vars.data(), te_vars.size(), &err);
+    if (!root) {
+        throw std::string("error at token " + std::to_string(err));
+    }
+    try {
+        _result = compile(root, values.data(), 0);
+    } catch (std::string s) {
+        te_free(root);
+        throw s;
+    }
+    te_free(root);
+
+    // map encoded operands to slots
+    auto slot = [this](uint32_t x) -> uint32_t {
+        uint32_t kind = x >> 16;
+        uint32_t index = x & 0xFFFF;
+        if (kind == KIND_VARIABLE) return index;
+        if (kind == KIND_CONSTANT) return _uses.size() + index;
+        return _uses.size() + _nconstants + index;
+    };
+    for (auto it = _code.begin(); it != _code.end(); ++it) {
+        for (uint16_t j = 0; j < it->arity; ++j) {
+            it->arg[j] = slot(it->arg[j]);
+        }
+    }
+    _result = slot(_result);
+}
+
+uint32_t pixel_expression::compile(const void* node, const double* var_addr, uint16_t reg) {
+    const te_expr* n = (const te_expr*)node;
+    int type = n->type & 0x1F;
+    if (type == TE_VARIABLE) {
+        uint16_t index = n->binding.bound - var_addr;
+        _uses[index] = true;
+        return (KIND_VARIABLE << 16) | index;
+    }
+    if (type == TE_CONSTANT_TYPE) {
+        _constants.resize(_constants.size() + BLOCK_SIZE, n->binding.value);
+        return (KIND_CONSTANT << 16) | (_nconstants++);
+    }
+    if (type < TE_FUNCTION0 || type > TE_FUNCTION3) {
+        throw std::string("unsupported function or closure");
+    }
+    instruction ins;
+    ins.op = te_builtin_op(n);
+    ins.dst = reg;
+    ins.fn = n->binding.function;
+    ins.arity = type - TE_FUNCTION0;
+    for (uint16_t j = 0; j < ins.arity; ++j) {
+        ins.arg[j] = compile(n->parameters[j], var_addr, reg + j);
+    }
+    _code.push_back(ins);
+    _nregisters = std::max(_nregisters, (uint16_t)(reg + 1));
+    return (KIND_REGISTER << 16) | reg;
+}
+
+void pixel_expression::eval(const std::vector<const double*>& vars, uint32_t n, double* out) const {
+    std::vector<double> registers(_nregisters * BLOCK_SIZE);
+    std::vector<const double*> slots(_uses.size() + _nconstants + _nregisters, nullptr);
+    for (uint32_t i = 0; i < _nconstants; ++i) {
+        slots[_uses.size() + i] = _constants.data() + i * BLOCK_SIZE;
+    }
+    for (uint16_t i = 0; i < _nregisters; ++i) {
+        slots[_uses.size() + _nconstants + i] = registers.data() + i * BLOCK_SIZE;
+    }
+
+    const uint32_t block_size = BLOCK_SIZE;  // std::min takes references, avoids odr-use of the static member
+    for (uint32_t i0 = 0; i0 < n; i0 += BLOCK_SIZE) {
+        const uint32_t len = std::min(block_size, n - i0);
+        for (uint16_t v = 0; v < _uses.size(); ++v) {
+            if (_uses[v]) slots[v] = vars[v] + i0;
+        }
+        for (auto it = _code.begin(); it != _code.end(); ++it) {
+            double* d = registers.data() + it->dst * BLOCK_SIZE;
+            const double* a = it->arity > 0 ? slots[it->arg[0]] : nullptr;
+            const double* b = it->arity > 1 ? slots[it->arg[1]] : nullptr;
+            const double* c = it->arity > 2 ? slots[it->arg[2]] : nullptr;
+            // the destination may alias the first operand, which is fine for element-wise operations
+            switch (it->op) {
+                case TE_OP_ADD:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = a[k] + b[k];
+                    break;
+                case TE_OP_SUB:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = a[k] - b[k];
+                    break;
+                case TE_OP_MUL:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = a[k] * b[k];
+                    break;
+                case TE_OP_DIV:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = a[k] / b[k];
+                    break;
+                case TE_OP_NEG:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = -a[k];
+                    break;
+                case TE_OP_COMMA:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = b[k];
+                    break;
+                case TE_OP_LT:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = a[k] < b[k];
+                    break;
+                case TE_OP_LTE:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = a[k] <= b[k];
+                    break;
+                case TE_OP_GT:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = a[k] > b[k];
+                    break;
+                case TE_OP_GTE:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = a[k] >= b[k];
+                    break;
+                case TE_OP_EQ:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = a[k] == b[k];
+                    break;
+                case TE_OP_NEQ:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = a[k] != b[k];
+                    break;
+                case TE_OP_AND:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = (int)(a[k]) && (int)(b[k]);
+                    break;
+                case TE_OP_OR:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = (int)(a[k]) || (int)(b[k]);
+                    break;
+                case TE_OP_NOT:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = !(int)(a[k]);
+                    break;
+                case TE_OP_IFELSE:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = (int)(a[k]) ? b[k] : c[k];
+                    break;
+                case TE_OP_ISNAN:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = std::isnan(a[k]);
+                    break;
+                case TE_OP_ISFINITE:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = std::isfinite(a[k]);
+                    break;
+                case TE_OP_ABS:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = std::fabs(a[k]);
+                    break;
+                case TE_OP_SQRT:
+                    for (uint32_t k = 0; k < len; ++k) d[k] = std::sqrt(a[k]);
+                    break;
+                default:
+                    switch (it->arity) {
+                        case 0:
+                            for (uint32_t k = 0; k < len; ++k) d[k] = ((double (*)(void))(it->fn))();
+                            break;
+                        case 1:
+                            for (uint32_t k = 0; k < len; ++k) d[k] = ((double (*)(double))(it->fn))(a[k]);
+                            break;
+                        case 2:
+                            for (uint32_t k = 0; k < len; ++k) d[k] = ((double (*)(double, double))(it->fn))(a[k], b[k]);
+                            break;
+                        case 3:
+                            for (uint32_t k = 0; k < len; ++k) d[k] = ((double (*)(double, double, double))(it->fn))(a[k], b[k], c[k]);
+                            break;
+                    }
+            }
+        }
+        std::memcpy(out + i0, slots[_result], sizeof(double) * len);
+    }
+}
+
+}  // namespace gdalcubes
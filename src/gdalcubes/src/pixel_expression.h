@@ -0,0 +1,92 @@
+/*
+    MIT License
+
+    Copyright (c) 2026 Marius Appel <marius.appel@hs-bochum.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef PIXEL_EXPRESSION_H
+#define PIXEL_EXPRESSION_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gdalcubes {
+
+/**
+ * @brief An arithmetic expression compiled to a flat bytecode that is evaluated over many pixels at once
+ *
+ * Expressions are parsed with tinyexpr and the resulting expression tree is translated into a sequence of
+ * instructions, each operating on blocks of values instead of single values. Operands of instructions are
+ * either variables, constants, or registers holding intermediate results. Built-in operators (e.g. arithmetic
+ * and logical operators, isnan(), ifelse()) are evaluated directly in tight loops, other functions are called per value.
+ *
+ * Instances are immutable after construction, i.e. one compiled expression can be evaluated from many threads.
+ */
+class pixel_expression {
+   public:
+    /**
+     * @brief Compile an expression
+     * @param expr expression string, symbols must be lower case
+     * @param vars names of variables that can be used in the expression, in the order as passed to eval()
+     * @throws std::string if the expression cannot be parsed
+     */
+    pixel_expression(std::string expr, std::vector<std::string> vars);
+
+    /**
+     * @brief Check whether a variable is used in the expression
+     * @param var index of the variable
+     */
+    inline bool uses(uint16_t var) const { return _uses[var]; }
+
+    /**
+     * @brief Evaluate the expression for n pixels
+     * @param vars pointers to n values of each variable, pointers of variables that are not used may be null
+     * @param n number of pixels
+     * @param out pointer to n values where results are written to
+     */
+    void eval(const std::vector<const double*>& vars, uint32_t n, double* out) const;
+
+   private:
+    struct instruction {
+        int op;            // TE_OP_* constant from tinyexpr.h
+        uint16_t dst;      // register
+        uint32_t arg[3];   // operand slots
+        void (*fn)(void);  // function to call if op is TE_OP_NONE
+        uint16_t arity;
+    };
+
+    // values are processed in blocks of this size
+    static const uint32_t BLOCK_SIZE = 256;
+
+    // operand slots are numbered as variables, constants, registers
+    std::vector<bool> _uses;
+    std::vector<double> _constants;  // BLOCK_SIZE copies of each constant
+    uint32_t _nconstants;
+    uint16_t _nregisters;
+    std::vector<instruction> _code;
+    uint32_t _result;  // slot of the result
+
+    uint32_t compile(const void* node, const double* var_addr, uint16_t reg);
+};
+
+}  // namespace gdalcubes
+
+#endif  //PIXEL_EXPRESSION_H
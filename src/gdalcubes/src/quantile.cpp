@@ -0,0 +1,136 @@
+/*
+    MIT License
+
+    Copyright (c) 2026 Marius Appel <marius.appel@hs-bochum.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "quantile.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gdalcubes {
+
+value_arena::value_arena(uint32_t n, uint32_t capacity) : _n(n), _capacity(std::max(capacity, uint32_t(1))), _values(size_t(n) * _capacity), _count(n, 0) {}
+
+void value_arena::grow() {
+    uint32_t capacity = 2 * _capacity;
+    std::vector<double> values(size_t(_n) * capacity);
+    for (uint32_t i = 0; i < _n; ++i) {
+        std::copy(_values.begin() + size_t(i) * _capacity, _values.begin() + size_t(i) * _capacity + _count[i], values.begin() + size_t(i) * capacity);
+    }
+    _values.swap(values);
+    _capacity = capacity;
+}
+
+double quantiles::median(double* x, uint32_t n) {
+    if (n == 0) return NAN;
+    std::nth_element(x, x + n / 2, x + n);
+    if (n % 2 == 1) {
+        return x[n / 2];
+    }
+    // all values before the n/2-th element are smaller or equal
+    return (x[n / 2] + *std::max_element(x, x + n / 2)) / ((double)2);
+}
+
+double quantiles::type7(double* x, uint32_t n, double p) {
+    if (n == 0) return NAN;
+    if (n == 1) return x[0];
+    if (p <= 1e-8) return *std::min_element(x, x + n);
+    if (p >= 1 - 1e-8) return *std::max_element(x, x + n);
+
+    double h = (double(n) - 1.0) * p;
+    uint32_t lo = (uint32_t)std::floor(h);
+    uint32_t hi = (uint32_t)std::ceil(h);
+    std::nth_element(x, x + lo, x + n);
+    double q_lo = x[lo];
+    // all values after the lo-th element are larger or equal
+    double q_hi = (hi > lo) ? *std::min_element(x + lo + 1, x + n) : q_lo;
+    return q_lo + (h - std::floor(h)) * (q_hi - q_lo);
+}
+
+p2_quantile::p2_quantile(uint32_t n, double p) : _p(p), _dn{0, p / 2, p, (1 + p) / 2, 1}, _q(5 * size_t(n), NAN), _pos(5 * size_t(n), 0), _count(n, 0) {}
+
+void p2_quantile::add(uint32_t i, double v) {
+    double* q = _q.data() + 5 * size_t(i);
+    uint32_t* pos = _pos.data() + 5 * size_t(i);
+
+    if (_count[i] < 5) {
+        q[_count[i]++] = v;
+        if (_count[i] == 5) {
+            std::sort(q, q + 5);
+            for (uint16_t j = 0; j < 5; ++j) pos[j] = j;
+        }
+        return;
+    }
+
+    // find cell of the new value and update extreme markers
+    uint16_t k;
+    if (v < q[0]) {
+        q[0] = v;
+        k = 0;
+    } else if (v < q[1]) {
+        k = 0;
+    } else if (v < q[2]) {
+        k = 1;
+    } else if (v < q[3]) {
+        k = 2;
+    } else if (v <= q[4]) {
+        k = 3;
+    } else {
+        q[4] = v;
+        k = 3;
+    }
+    for (uint16_t j = k + 1; j < 5; ++j) ++pos[j];
+    ++_count[i];
+
+    // adjust heights of inner markers if they are off from their desired positions
+    for (uint16_t j = 1; j < 4; ++j) {
+        double d = (_count[i] - 1) * _dn[j] - pos[j];
+        double n_prev = double(pos[j - 1]) - pos[j];
+        double n_next = double(pos[j + 1]) - pos[j];
+        if ((d >= 1 && n_next > 1) || (d <= -1 && n_prev < -1)) {
+            int s = (d >= 0) ? 1 : -1;
+            // piecewise parabolic prediction
+            double qp = q[j] + s / (n_next - n_prev) *
+                                   ((s - n_prev) * (q[j + 1] - q[j]) / n_next +
+                                    (n_next - s) * (q[j] - q[j - 1]) / (-n_prev));
+            if (q[j - 1] < qp && qp < q[j + 1]) {
+                q[j] = qp;
+            } else {
+                // linear prediction
+                q[j] = q[j] + s * (q[j + s] - q[j]) / (double(pos[j + s]) - pos[j]);
+            }
+            pos[j] += s;
+        }
+    }
+}
+
+double p2_quantile::get(uint32_t i) const {
+    if (_count[i] <= 5) {
+        double x[5];
+        std::copy(_q.begin() + 5 * size_t(i), _q.begin() + 5 * size_t(i) + _count[i], x);
+        return quantiles::type7(x, _count[i], _p);
+    }
+    return _q[5 * size_t(i) + 2];
+}
+
+}  // namespace gdalcubes
@@ -0,0 +1,129 @@
+/*
+    MIT License
+
+    Copyright (c) 2026 Marius Appel <marius.appel@hs-bochum.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef QUANTILE_H
+#define QUANTILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gdalcubes {
+
+/**
+ * @brief Contiguous storage of a variable number of values for many pixels
+ *
+ * Values of each pixel are stored in a fixed-size slot of one buffer. If a slot is full,
+ * the capacity of all slots is doubled, i.e., no per-pixel heap allocations are needed.
+ */
+class value_arena {
+   public:
+    /**
+     * @brief Create an arena for n pixels
+     * @param n number of pixels
+     * @param capacity initial number of values per pixel
+     */
+    value_arena(uint32_t n, uint32_t capacity = 8);
+
+    /**
+     * @brief Append a value to the values of pixel i
+     */
+    inline void push(uint32_t i, double v) {
+        if (_count[i] == _capacity) grow();
+        _values[size_t(i) * _capacity + _count[i]++] = v;
+    }
+
+    /**
+     * @brief Pointer to the values of pixel i, values may be reordered by the caller
+     */
+    inline double* values(uint32_t i) { return _values.data() + size_t(i) * _capacity; }
+
+    /**
+     * @brief Number of values of pixel i
+     */
+    inline uint32_t count(uint32_t i) const { return _count[i]; }
+
+   private:
+    void grow();
+
+    uint32_t _n;
+    uint32_t _capacity;
+    std::vector<double> _values;
+    std::vector<uint32_t> _count;
+};
+
+/**
+ * @brief Order statistics computed by selection instead of sorting
+ * @note Functions reorder the given values
+ */
+class quantiles {
+   public:
+    /**
+     * @brief Median of n values, NAN if n is 0
+     */
+    static double median(double* x, uint32_t n);
+
+    /**
+     * @brief Sample quantile of n values, NAN if n is 0
+     * @note Uses type 7 from Hyndman, R. J. and Fan, Y. (1996) Sample quantiles in statistical packages, American Statistician 50, 361–365. doi:10.2307/2684934.
+     */
+    static double type7(double* x, uint32_t n, double p);
+};
+
+/**
+ * @brief Approximate quantiles of many pixels in constant memory
+ *
+ * Implements the P² algorithm (Jain, R. and Chlamtac, I. (1985) The P² algorithm for dynamic calculation of quantiles and
+ * histograms without storing observations, Communications of the ACM 28, 1076–1085. doi:10.1145/4372.4378), which
+ * keeps five markers per pixel. Results are exact for up to five values.
+ */
+class p2_quantile {
+   public:
+    /**
+     * @brief Create estimators for n pixels
+     * @param n number of pixels
+     * @param p probability of the quantile
+     */
+    p2_quantile(uint32_t n, double p);
+
+    /**
+     * @brief Add a value of pixel i
+     */
+    void add(uint32_t i, double v);
+
+    /**
+     * @brief Current estimate of pixel i, NAN if no values have been added
+     */
+    double get(uint32_t i) const;
+
+   private:
+    double _p;
+    double _dn[5];                 // increments of desired marker positions
+    std::vector<double> _q;        // marker heights, 5 per pixel
+    std::vector<uint32_t> _pos;    // marker positions, 5 per pixel
+    std::vector<uint32_t> _count;  // number of values per pixel
+};
+
+}  // namespace gdalcubes
+
+#endif  //QUANTILE_H
@@ -23,6 +23,7 @@
 */
 
 #include "reduce_space.h"
+#include "quantile.h"
 
 namespace gdalcubes {
 
@@ -253,7 +254,7 @@ struct median_reducer_singleband_s : public reducer_singleband_s {
     void init(std::shared_ptr<chunk_data> a, uint16_t band_idx_in, uint16_t band_idx_out, std::shared_ptr<cube> in_cube) override {
         _band_idx_in = band_idx_in;
         _band_idx_out = band_idx_out;
-        _m_buckets.resize(a->size()[1], std::vector<double>());
+        _values = std::make_shared<value_arena>(a->size()[1], in_cube->chunk_size()[1] * in_cube->chunk_size()[2]);
     }
 
     void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
@@ -261,7 +262,7 @@ struct median_reducer_singleband_s : public reducer_singleband_s {
             for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
                 double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
                 if (!std::isnan(v)) {
-                    _m_buckets[it].push_back(v);
+                    _values->push(it, v);
                 }
             }
         }
@@ -269,20 +270,13 @@ struct median_reducer_singleband_s : public reducer_singleband_s {
 
     void finalize(std::shared_ptr<chunk_data> a) override {
         for (uint32_t it = 0; it < a->size()[1]; ++it) {
-            std::vector<double> &list = _m_buckets[it];
-            std::sort(list.begin(), list.end());
-            if (list.size() == 0) {
-                ((double *)a->buf())[_band_idx_out * a->size()[1] + it] = NAN;
-            } else if (list.size() % 2 == 1) {
-                ((double *)a->buf())[_band_idx_out * a->size()[1] + it] = list[list.size() / 2];
-            } else {
-                ((double *)a->buf())[_band_idx_out * a->size()[1] + it] = (list[list.size() / 2] + list[list.size() / 2 - 1]) / ((double)2);
-            }
+            ((double *)a->buf())[_band_idx_out * a->size()[1] + it] = quantiles::median(_values->values(it), _values->count(it));
         }
+        _values.reset();
     }
 
    private:
-    std::vector<std::vector<double>> _m_buckets;
+    std::shared_ptr<value_arena> _values;
     uint16_t _band_idx_in;
     uint16_t _band_idx_out;
 };
@@ -23,6 +23,9 @@
 */
 #include "reduce_time.h"
 
+#include "nan_kernels.h"
+#include "quantile.h"
+
 namespace gdalcubes {
 
 struct reducer_singleband {
@@ -51,136 +54,127 @@ struct reducer_singleband {
 };
 
 /**
- * @brief Implementation of reducer to calculate sum values over time
+ * @brief Fused implementation of reducers that only need running statistics, i.e., sum, prod, mean, min, max, count, var, and sd
+ *
+ * All requested statistics of one band are computed in a single pass over input chunks. Statistics share their state
+ * (e.g. mean, var, and sd use the same counts) and pixels are processed in blocks, such that input values are loaded
+ * only once from memory, no matter how many statistics are requested. Variances are computed with Welford's online algorithm.
  */
-struct sum_reducer_singleband : public reducer_singleband {
-    void init(std::shared_ptr<chunk_data> a, uint16_t band_idx_in, uint16_t band_idx_out, std::shared_ptr<cube> in_cube) override {
-        _band_idx_in = band_idx_in;
-        _band_idx_out = band_idx_out;
-        for (uint32_t ixy = 0; ixy < a->size()[2] * a->size()[3]; ++ixy) {
-            ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = 0;
-        }
+struct moments_reducer_singleband : public reducer_singleband {
+    /**
+     * @brief Check whether a reducer can be computed by this class
+     */
+    static bool supports(std::string reducer) {
+        return reducer == "sum" || reducer == "prod" || reducer == "mean" || reducer == "min" ||
+               reducer == "max" || reducer == "count" || reducer == "var" || reducer == "sd";
     }
 
-    void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
-                if (!std::isnan(v)) {
-                    ((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy] += v;
-                }
-            }
-        }
+    /**
+     * @brief Add a statistic that shall be computed
+     * @param reducer name of the statistic
+     * @param band_idx_out to which band of the result chunk (zero-based index) shall the statistic be written?
+     */
+    void add(std::string reducer, uint16_t band_idx_out) {
+        _outputs.push_back(std::make_pair(reducer, band_idx_out));
     }
-    void finalize(std::shared_ptr<chunk_data> a) override {}
-
-   private:
-    uint16_t _band_idx_in;
-    uint16_t _band_idx_out;
-};
 
-/**
- * @brief Implementation of reducer to calculate product values over time
- */
-struct prod_reducer_singleband : public reducer_singleband {
     void init(std::shared_ptr<chunk_data> a, uint16_t band_idx_in, uint16_t band_idx_out, std::shared_ptr<cube> in_cube) override {
         _band_idx_in = band_idx_in;
-        _band_idx_out = band_idx_out;
-        for (uint32_t ixy = 0; ixy < a->size()[2] * a->size()[3]; ++ixy) {
-            ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = 1;
-        }
-    }
-
-    void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
-                if (!std::isnan(v)) {
-                    ((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy] *= v;
-                }
-            }
+        _has_sum = _has_count = _has_welford = _has_min = _has_max = _has_prod = false;
+        for (uint16_t i = 0; i < _outputs.size(); ++i) {
+            std::string r = _outputs[i].first;
+            _has_sum = _has_sum || r == "sum" || r == "mean";
+            _has_count = _has_count || r == "count" || r == "mean" || r == "var" || r == "sd";
+            _has_welford = _has_welford || r == "var" || r == "sd";
+            _has_min = _has_min || r == "min";
+            _has_max = _has_max || r == "max";
+            _has_prod = _has_prod || r == "prod";
         }
-    }
-    void finalize(std::shared_ptr<chunk_data> a) override {}
-
-   private:
-    uint16_t _band_idx_in;
-    uint16_t _band_idx_out;
-};
-
-/**
- * @brief Implementation of reducer to calculate mean values over time
- */
-struct mean_reducer_singleband : public reducer_singleband {
-    void init(std::shared_ptr<chunk_data> a, uint16_t band_idx_in, uint16_t band_idx_out, std::shared_ptr<cube> in_cube) override {
-        _band_idx_in = band_idx_in;
-        _band_idx_out = band_idx_out;
-        _count = (uint32_t *)std::calloc(a->size()[2] * a->size()[3], sizeof(uint32_t));
-        for (uint32_t ixy = 0; ixy < a->size()[2] * a->size()[3]; ++ixy) {
-            _count[ixy] = 0;
-            ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = 0;
+        uint32_t nxy = a->size()[2] * a->size()[3];
+        if (_has_sum) _sum.assign(nxy, 0);
+        if (_has_count) _count.assign(nxy, 0);
+        if (_has_welford) {
+            _mean.assign(nxy, 0);
+            _m2.assign(nxy, 0);
         }
+        if (_has_min) _min.assign(nxy, NAN);
+        if (_has_max) _max.assign(nxy, NAN);
+        if (_has_prod) _prod.assign(nxy, 1);
     }
 
     void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
-                if (!std::isnan(v)) {
-                    ((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy] += v;
-                    ++_count[ixy];
+        uint32_t nxy = b->size()[2] * b->size()[3];
+        const double *in = ((double *)b->buf()) + _band_idx_in * b->size()[1] * nxy;
+        for (uint32_t start = 0; start < nxy; start += BLOCK_SIZE) {
+            uint32_t n = std::min(BLOCK_SIZE, nxy - start);
+            for (uint32_t it = 0; it < b->size()[1]; ++it) {
+                const double *x = in + it * nxy + start;
+                if (_has_welford) {
+                    // also updates counts
+                    nan_kernels::welford(x, _mean.data() + start, _m2.data() + start, _count.data() + start, n);
+                    if (_has_sum) nan_kernels::sum(x, _sum.data() + start, n);
+                } else if (_has_sum && _has_count) {
+                    nan_kernels::sum_count(x, _sum.data() + start, _count.data() + start, n);
+                } else if (_has_sum) {
+                    nan_kernels::sum(x, _sum.data() + start, n);
+                } else if (_has_count) {
+                    nan_kernels::count(x, _count.data() + start, n);
                 }
+                if (_has_min) nan_kernels::min(x, _min.data() + start, n);
+                if (_has_max) nan_kernels::max(x, _max.data() + start, n);
+                if (_has_prod) nan_kernels::prod(x, _prod.data() + start, n);
             }
         }
     }
 
     void finalize(std::shared_ptr<chunk_data> a) override {
-        // divide by count;
-        for (uint32_t ixy = 0; ixy < a->size()[2] * a->size()[3]; ++ixy) {
-            ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = _count[ixy] > 0 ? ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] / _count[ixy] : NAN;
-        }
-        std::free(_count);
-    }
-
-   private:
-    uint32_t *_count;
-    uint16_t _band_idx_in;
-    uint16_t _band_idx_out;
-};
-
-/**
- * @brief Implementation of reducer to calculate minimum values over time
- */
-struct min_reducer_singleband : public reducer_singleband {
-    void init(std::shared_ptr<chunk_data> a, uint16_t band_idx_in, uint16_t band_idx_out, std::shared_ptr<cube> in_cube) override {
-        _band_idx_in = band_idx_in;
-        _band_idx_out = band_idx_out;
-        for (uint32_t ixy = 0; ixy < a->size()[2] * a->size()[3]; ++ixy) {
-            ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = NAN;
-        }
-    }
-
-    void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
-                if (!std::isnan(v)) {
-                    double *w = &(((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy]);
-                    if (std::isnan(*w))
-                        *w = v;
-                    else
-                        *w = std::min(*w, v);
+        uint32_t nxy = a->size()[2] * a->size()[3];
+        for (uint16_t i = 0; i < _outputs.size(); ++i) {
+            std::string r = _outputs[i].first;
+            double *out = ((double *)a->buf()) + _outputs[i].second * nxy;
+            if (r == "sum") {
+                std::copy(_sum.begin(), _sum.end(), out);
+            } else if (r == "count") {
+                std::copy(_count.begin(), _count.end(), out);
+            } else if (r == "min") {
+                std::copy(_min.begin(), _min.end(), out);
+            } else if (r == "max") {
+                std::copy(_max.begin(), _max.end(), out);
+            } else if (r == "prod") {
+                std::copy(_prod.begin(), _prod.end(), out);
+            } else if (r == "mean") {
+                for (uint32_t ixy = 0; ixy < nxy; ++ixy) {
+                    out[ixy] = _count[ixy] > 0 ? _sum[ixy] / _count[ixy] : NAN;
+                }
+            } else if (r == "var") {
+                for (uint32_t ixy = 0; ixy < nxy; ++ixy) {
+                    out[ixy] = _count[ixy] > 1 ? _m2[ixy] / (_count[ixy] - 1) : NAN;
+                }
+            } else if (r == "sd") {
+                for (uint32_t ixy = 0; ixy < nxy; ++ixy) {
+                    out[ixy] = _count[ixy] > 1 ? sqrt(_m2[ixy] / (_count[ixy] - 1)) : NAN;
                 }
             }
         }
+        _sum.clear();
+        _count.clear();
+        _mean.clear();
+        _m2.clear();
+        _min.clear();
+        _max.clear();
+        _prod.clear();
     }
 
-    void finalize(std::shared_ptr<chunk_data> a) override {}
-
    private:
+    // number of pixels processed at once, such that input values and states stay in cache
+    static const uint32_t BLOCK_SIZE = 1024;
+
+    std::vector<std::pair<std::string, uint16_t>> _outputs;
     uint16_t _band_idx_in;
-    uint16_t _band_idx_out;
+    bool _has_sum, _has_count, _has_welford, _has_min, _has_max, _has_prod;
+    std::vector<double> _sum, _count, _mean, _m2, _min, _max, _prod;
 };
+const uint32_t moments_reducer_singleband::BLOCK_SIZE;
 
 /**
  * @brief Implementation of reducer to calculate the date of the minimum over time
@@ -235,40 +229,6 @@ struct which_min_reducer_singleband : public reducer_singleband {
     std::weak_ptr<cube> _in_cube;
 };
 
-/**
- * @brief Implementation of reducer to calculate maximum values over time
- */
-struct max_reducer_singleband : public reducer_singleband {
-    void init(std::shared_ptr<chunk_data> a, uint16_t band_idx_in, uint16_t band_idx_out, std::shared_ptr<cube> in_cube) override {
-        _band_idx_in = band_idx_in;
-        _band_idx_out = band_idx_out;
-        for (uint32_t ixy = 0; ixy < a->size()[2] * a->size()[3]; ++ixy) {
-            ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = NAN;
-        }
-    }
-
-    void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
-                if (!std::isnan(v)) {
-                    double *w = &(((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy]);
-                    if (std::isnan(*w))
-                        *w = v;
-                    else
-                        *w = std::max(*w, v);
-                }
-            }
-        }
-    }
-
-    void finalize(std::shared_ptr<chunk_data> a) override {}
-
-   private:
-    uint16_t _band_idx_in;
-    uint16_t _band_idx_out;
-};
-
 /**
  * @brief Implementation of reducer to calculate the date of the minimum over time
  */
@@ -322,52 +282,25 @@ struct which_max_reducer_singleband : public reducer_singleband {
     std::weak_ptr<cube> _in_cube;
 };
 
-struct count_reducer_singleband : public reducer_singleband {
-    void init(std::shared_ptr<chunk_data> a, uint16_t band_idx_in, uint16_t band_idx_out, std::shared_ptr<cube> in_cube) override {
-        _band_idx_in = band_idx_in;
-        _band_idx_out = band_idx_out;
-        for (uint32_t ixy = 0; ixy < a->size()[2] * a->size()[3]; ++ixy) {
-            ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = 0;
-        }
-    }
-
-    void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
-                if (!std::isnan(v)) {
-                    double *w = &(((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy]);
-                    *w += 1;
-                }
-            }
-        }
-    }
-
-    void finalize(std::shared_ptr<chunk_data> a) override {}
-
-   private:
-    uint16_t _band_idx_in;
-    uint16_t _band_idx_out;
-};
-
 /**
  * @brief Implementation of reducer to calculate median values over time
- * @note Calculating the exact median has a strong memory overhead, approximate median reducers might be implemented in the future
+ * @note Calculating the exact median has a strong memory overhead, use approx_quantile_reducer_singleband for very long time series
  */
 struct median_reducer_singleband : public reducer_singleband {
     void init(std::shared_ptr<chunk_data> a, uint16_t band_idx_in, uint16_t band_idx_out, std::shared_ptr<cube> in_cube) override {
         _band_idx_in = band_idx_in;
         _band_idx_out = band_idx_out;
-        //_m_buckets = std::vector< std::vector<double> > (a->size()[2] * a->size()[3],std::vector<double>(0));
-        _m_buckets.resize(a->size()[2] * a->size()[3], std::vector<double>());
+        _values = std::make_shared<value_arena>(a->size()[2] * a->size()[3], in_cube->chunk_size()[0]);
     }
 
     void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
+        uint32_t nxy = b->size()[2] * b->size()[3];
+        const double *in = ((double *)b->buf()) + _band_idx_in * b->size()[1] * nxy;
+        for (uint32_t ixy = 0; ixy < nxy; ++ixy) {
+            for (uint32_t it = 0; it < b->size()[1]; ++it) {
+                double v = in[it * nxy + ixy];
                 if (!std::isnan(v)) {
-                    _m_buckets[ixy].push_back(v);
+                    _values->push(ixy, v);
                 }
             }
         }
@@ -375,26 +308,17 @@ struct median_reducer_singleband : public reducer_singleband {
 
     void finalize(std::shared_ptr<chunk_data> a) override {
         for (uint32_t ixy = 0; ixy < a->size()[2] * a->size()[3]; ++ixy) {
-            std::vector<double> &list = _m_buckets[ixy];
-            std::sort(list.begin(), list.end());
-            if (list.size() == 0) {
-                ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = NAN;
-            } else if (list.size() % 2 == 1) {
-                ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = list[list.size() / 2];
-            } else {
-                ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = (list[list.size() / 2] + list[list.size() / 2 - 1]) / ((double)2);
-            }
+            ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = quantiles::median(_values->values(ixy), _values->count(ixy));
         }
+        _values.reset();
     }
 
    private:
-    std::vector<std::vector<double>> _m_buckets;
+    std::shared_ptr<value_arena> _values;
     uint16_t _band_idx_in;
     uint16_t _band_idx_out;
 };
 
-
-
 /**
  * @brief Implementation of reducer to calculate arbitrary quantile values over time
  * @note Uses type 7 from Hyndman, R. J. and Fan, Y. (1996) Sample quantiles in statistical packages, American Statistician 50, 361–365. doi:10.2307/2684934.
@@ -403,17 +327,18 @@ struct quantile_reducer_singleband : public reducer_singleband {
     void init(std::shared_ptr<chunk_data> a, uint16_t band_idx_in, uint16_t band_idx_out, std::shared_ptr<cube> in_cube) override {
         _band_idx_in = band_idx_in;
         _band_idx_out = band_idx_out;
-        //_m_buckets = std::vector< std::vector<double> > (a->size()[2] * a->size()[3],std::vector<double>(0));
-        _m_buckets.resize(a->size()[2] * a->size()[3], std::vector<double>());
+        _values = std::make_shared<value_arena>(a->size()[2] * a->size()[3], in_cube->chunk_size()[0]);
         //_p = 0.5; // DO NOT SET HERE!!!
     }
 
     void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
-        for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
+        uint32_t nxy = b->size()[2] * b->size()[3];
+        const double *in = ((double *)b->buf()) + _band_idx_in * b->size()[1] * nxy;
+        for (uint32_t ixy = 0; ixy < nxy; ++ixy) {
+            for (uint32_t it = 0; it < b->size()[1]; ++it) {
+                double v = in[it * nxy + ixy];
                 if (!std::isnan(v)) {
-                    _m_buckets[ixy].push_back(v);
+                    _values->push(ixy, v);
                 }
             }
         }
@@ -425,102 +350,58 @@ struct quantile_reducer_singleband : public reducer_singleband {
 
     void finalize(std::shared_ptr<chunk_data> a) override {
         for (uint32_t ixy = 0; ixy < a->size()[2] * a->size()[3]; ++ixy) {
-            std::vector<double> &list = _m_buckets[ixy];
-            std::sort(list.begin(), list.end());
-            if (list.size() == 0) {
-                ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = NAN;
-            } else if (list.size() == 1) {
-                ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = list[0];
-            } else if (_p <= 1e-8) {
-                ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = list[0];
-            } else if (_p >= 1-1e-8) {
-                ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = list[list.size() - 1];
-            }
-            else {
-                uint32_t n = list.size();
-                double h = (double(n)-1.0)*_p;
-                double Qp = list[std::floor(h)] + (h - std::floor(h))*(list[std::ceil(h)]-list[std::floor(h)]);
-                ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = Qp;
-            }
+            ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = quantiles::type7(_values->values(ixy), _values->count(ixy), _p);
         }
+        _values.reset();
     }
 
    private:
-    std::vector<std::vector<double>> _m_buckets;
+    std::shared_ptr<value_arena> _values;
     uint16_t _band_idx_in;
     uint16_t _band_idx_out;
     double _p;
 };
 
-
-
-
-
-
-
-
-
-
 /**
- * @brief Implementation of reducer to calculate variance values over time using Welford's Online algorithm
+ * @brief Implementation of reducer to calculate approximate quantile values over time in constant memory per pixel
+ * @see p2_quantile
  */
-struct var_reducer_singleband : public reducer_singleband {
+struct approx_quantile_reducer_singleband : public reducer_singleband {
     void init(std::shared_ptr<chunk_data> a, uint16_t band_idx_in, uint16_t band_idx_out, std::shared_ptr<cube> in_cube) override {
         _band_idx_in = band_idx_in;
         _band_idx_out = band_idx_out;
-        _count = (uint32_t *)std::calloc(a->size()[2] * a->size()[3], sizeof(uint32_t));
-        _mean = (double *)std::calloc(a->size()[2] * a->size()[3], sizeof(double));
-        for (uint32_t ixy = 0; ixy < a->size()[2] * a->size()[3]; ++ixy) {
-            _count[ixy] = 0;
-            _mean[ixy] = 0;
-            ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = 0;
-        }
+        _estimator = std::make_shared<p2_quantile>(a->size()[2] * a->size()[3], _p);
     }
 
     void combine(std::shared_ptr<chunk_data> a, std::shared_ptr<chunk_data> b, chunkid_t chunk_id) override {
+        uint32_t nxy = b->size()[2] * b->size()[3];
+        const double *in = ((double *)b->buf()) + _band_idx_in * b->size()[1] * nxy;
         for (uint32_t it = 0; it < b->size()[1]; ++it) {
-            for (uint32_t ixy = 0; ixy < b->size()[2] * b->size()[3]; ++ixy) {
-                double &v = ((double *)b->buf())[_band_idx_in * b->size()[1] * b->size()[2] * b->size()[3] + it * b->size()[2] * b->size()[3] + ixy];
+            for (uint32_t ixy = 0; ixy < nxy; ++ixy) {
+                double v = in[it * nxy + ixy];
                 if (!std::isnan(v)) {
-                    double &mean = _mean[ixy];
-                    uint32_t &count = _count[ixy];
-                    ++count;
-                    double delta = v - mean;
-                    mean += delta / count;
-                    ((double *)a->buf())[_band_idx_out * a->size()[1] * a->size()[2] * a->size()[3] + ixy] += delta * (v - mean);
+                    _estimator->add(ixy, v);
                 }
             }
         }
     }
 
-    virtual void finalize(std::shared_ptr<chunk_data> a) override {
-        // divide by count - 1;
-        for (uint32_t ixy = 0; ixy < a->size()[2] * a->size()[3]; ++ixy) {
-            ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = _count[ixy] > 1 ? ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] / (_count[ixy] - 1) : NAN;
-        }
-        std::free(_count);
-        std::free(_mean);
+    void set_p(double p) {
+        _p = p;
     }
 
-   protected:
-    uint32_t *_count;
-    double *_mean;
-    uint16_t _band_idx_in;
-    uint16_t _band_idx_out;
-};
-
-/**
- * @brief Implementation of reducer to calculate standard deviation values over time using Welford's Online algorithm
- */
-struct sd_reducer_singleband : public var_reducer_singleband {
     void finalize(std::shared_ptr<chunk_data> a) override {
-        // divide by count - 1;
         for (uint32_t ixy = 0; ixy < a->size()[2] * a->size()[3]; ++ixy) {
-            ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = _count[ixy] > 1 ? sqrt(((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] / (_count[ixy] - 1)) : NAN;
+            ((double *)a->buf())[_band_idx_out * a->size()[2] * a->size()[3] + ixy] = _estimator->get(ixy);
         }
-        std::free(_count);
-        std::free(_mean);
+        _estimator.reset();
     }
+
+   private:
+    std::shared_ptr<p2_quantile> _estimator;
+    uint16_t _band_idx_in;
+    uint16_t _band_idx_out;
+    double _p;
 };
 
 std::shared_ptr<chunk_data> reduce_time_cube::read_chunk(chunkid_t id) {
@@ -539,26 +420,27 @@ std::shared_ptr<chunk_data> reduce_time_cube::read_chunk(chunkid_t id) {
     out->size(size_btyx);
 
     std::vector<reducer_singleband *> reducers;
+    std::vector<uint16_t> reducers_band_in;
+    std::vector<uint16_t> reducers_band_out;
+
+    // running statistics of the same band are computed by one fused reducer
+    std::map<uint16_t, moments_reducer_singleband *> moments;
     for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
+        uint16_t band_idx_in = _in_cube->bands().get_index(_reducer_bands[i].second);
+        if (moments_reducer_singleband::supports(_reducer_bands[i].first)) {
+            if (moments.count(band_idx_in) == 0) {
+                moments[band_idx_in] = new moments_reducer_singleband();
+                reducers.push_back(moments[band_idx_in]);
+                reducers_band_in.push_back(band_idx_in);
+                reducers_band_out.push_back(i);
+            }
+            moments[band_idx_in]->add(_reducer_bands[i].first, i);
+            continue;
+        }
+
         reducer_singleband *r = nullptr;
-        if (_reducer_bands[i].first == "min") {
-            r = new min_reducer_singleband();
-        } else if (_reducer_bands[i].first == "max") {
-            r = new max_reducer_singleband();
-        } else if (_reducer_bands[i].first == "mean") {
-            r = new mean_reducer_singleband();
-        } else if (_reducer_bands[i].first == "median") {
+        if (_reducer_bands[i].first == "median") {
             r = new median_reducer_singleband();
-        } else if (_reducer_bands[i].first == "sum") {
-            r = new sum_reducer_singleband();
-        } else if (_reducer_bands[i].first == "count") {
-            r = new count_reducer_singleband();
-        } else if (_reducer_bands[i].first == "prod") {
-            r = new prod_reducer_singleband();
-        } else if (_reducer_bands[i].first == "var") {
-            r = new var_reducer_singleband();
-        } else if (_reducer_bands[i].first == "sd") {
-            r = new sd_reducer_singleband();
         } else if (_reducer_bands[i].first == "which_min") {
             r = new which_min_reducer_singleband();
         } else if (_reducer_bands[i].first == "which_max") {
@@ -569,10 +451,21 @@ std::shared_ptr<chunk_data> reduce_time_cube::read_chunk(chunkid_t id) {
         } else if (_reducer_bands[i].first == "Q3") {
             r = new quantile_reducer_singleband();
             dynamic_cast<quantile_reducer_singleband*>(r)->set_p(0.75);
+        } else if (_reducer_bands[i].first == "median_approx") {
+            r = new approx_quantile_reducer_singleband();
+            dynamic_cast<approx_quantile_reducer_singleband*>(r)->set_p(0.5);
+        } else if (_reducer_bands[i].first == "Q1_approx") {
+            r = new approx_quantile_reducer_singleband();
+            dynamic_cast<approx_quantile_reducer_singleband*>(r)->set_p(0.25);
+        } else if (_reducer_bands[i].first == "Q3_approx") {
+            r = new approx_quantile_reducer_singleband();
+            dynamic_cast<approx_quantile_reducer_singleband*>(r)->set_p(0.75);
         } else
             throw std::string("ERROR in reduce_time_cube::read_chunk(): Unknown reducer given");
 
         reducers.push_back(r);
+        reducers_band_in.push_back(band_idx_in);
+        reducers_band_out.push_back(i);
     }
 
     // iterate over all chunks that must be read from the input cube to compute this chunk
@@ -596,14 +489,13 @@ std::shared_ptr<chunk_data> reduce_time_cube::read_chunk(chunkid_t id) {
                 double *begin = (double *)out->buf();
                 double *end = ((double *)out->buf()) + size_btyx[0] * size_btyx[1] * size_btyx[2] * size_btyx[3];
                 std::fill(begin, end, NAN);
-                for (uint16_t ib = 0; ib < _reducer_bands.size(); ++ib) {
-                    uint16_t band_idx_in = _in_cube->bands().get_index(_reducer_bands[ib].second);
-                    reducers[ib]->init(out, band_idx_in, ib, _in_cube);
+                for (uint16_t ir = 0; ir < reducers.size(); ++ir) {
+                    reducers[ir]->init(out, reducers_band_in[ir], reducers_band_out[ir], _in_cube);
                 }
                 initialized = true;
             }
-            for (uint16_t ib = 0; ib < _reducer_bands.size(); ++ib) {
-                reducers[ib]->combine(out, x, i);
+            for (uint16_t ir = 0; ir < reducers.size(); ++ir) {
+                reducers[ir]->combine(out, x, i);
             }
             empty = false;
         }
@@ -614,7 +506,7 @@ std::shared_ptr<chunk_data> reduce_time_cube::read_chunk(chunkid_t id) {
        out->set_status(s);
     }
     else {
-        for (uint16_t i = 0; i < _reducer_bands.size(); ++i) {
+        for (uint16_t i = 0; i < reducers.size(); ++i) {
             reducers[i]->finalize(out);
         }
     }
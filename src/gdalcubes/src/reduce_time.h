@@ -99,7 +99,10 @@ class reduce_time_cube : public cube {
                   reducerstr == "which_min" ||
                   reducerstr == "which_max" ||
                   reducerstr == "Q1" ||
-                  reducerstr == "Q3"))
+                  reducerstr == "Q3" ||
+                  reducerstr == "median_approx" ||
+                  reducerstr == "Q1_approx" ||
+                  reducerstr == "Q3_approx"))
                 throw std::string("ERROR in reduce_time_cube::reduce_time_cube(): Unknown reducer '" + reducerstr + "'");
 
             if (!(in->bands().has(bandstr))) {
@@ -124,6 +127,11 @@ class reduce_time_cube : public cube {
 
     std::shared_ptr<chunk_data> read_chunk(chunkid_t id) override;
 
+    chunk_order suggest_chunk_order() override {
+        // output chunks contain complete time series, spatially neighbouring chunks may share blocks of source images
+        return chunk_order::ZORDER;
+    }
+
     /**
  * Combines all chunks and produces a single GDAL image
  * @param path path to output image file
@@ -34,11 +34,11 @@ std::shared_ptr<chunk_data> select_time_cube::read_chunk(chunkid_t id) {
             input_chunk_coords[0] = iin / _in_cube->chunk_size()[0];
             chunkid_t input_chunk_id = _in_cube->chunk_id_from_coords(input_chunk_coords);
             if (!in_chunk) {
-                in_chunk = _in_cube->read_chunk(input_chunk_id);
+                in_chunk = _in_cube->read_chunk_cached(input_chunk_id);
                 cur_input_chunk_id = input_chunk_id;
             } else {
                 if (cur_input_chunk_id != input_chunk_id) {
-                    in_chunk = _in_cube->read_chunk(input_chunk_id);
+                    in_chunk = _in_cube->read_chunk_cached(input_chunk_id);
                     cur_input_chunk_id = input_chunk_id;
                 }
             }
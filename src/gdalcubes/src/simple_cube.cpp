@@ -25,6 +25,7 @@
 
 #include <set>
 
+#include "dataset_pool.h"
 #include "datetime.h"
 
 namespace gdalcubes {
@@ -278,11 +279,10 @@ std::shared_ptr<chunk_data> simple_cube::read_chunk(chunkid_t id) {
             std::string gdal_file = file_band.first;
             uint16_t gdal_band = file_band.second;
 
-            GDALDataset *dataset = (GDALDataset *)GDALOpen(gdal_file.c_str(), GA_ReadOnly);
+            GDALDataset *dataset = gdal_dataset_pool::instance()->acquire(gdal_file);
             if (!dataset) {
                 GCBS_WARN("GDAL could not open '" + gdal_file + "':  ERROR no " + std::to_string(CPLGetLastErrorNo()) + ":" + CPLGetLastErrorMsg());
                 if (_strict) {
-                    GDALClose(dataset);
                     out = std::make_shared<chunk_data>();
                     out->set_status(chunk_data::chunk_status::ERROR);
                     return out;
@@ -294,7 +294,7 @@ std::shared_ptr<chunk_data> simple_cube::read_chunk(chunkid_t id) {
 
             double affine_in[6] = {0, 0, 1, 0, 0, 1};
             if (dataset->GetGeoTransform(affine_in) != CE_None) {
-                GDALClose(dataset);
+                gdal_dataset_pool::instance()->release(dataset);
                 GCBS_DEBUG("GDAL failed to fetch geotransform parameters for '" + gdal_file + "'");
                 continue;
             }
@@ -349,17 +349,18 @@ std::shared_ptr<chunk_data> simple_cube::read_chunk(chunkid_t id) {
                 if (res != CE_None) {
                     GCBS_WARN("RasterIO (read) failed for '" + gdal_file + "':  ERROR no " + std::to_string(CPLGetLastErrorNo()) + ":" + CPLGetLastErrorMsg());
                     if (_strict) {
-                        GDALClose(dataset);
+                        gdal_dataset_pool::instance()->release(dataset);
                         out = std::make_shared<chunk_data>();
                         out->set_status(chunk_data::chunk_status::ERROR);
                         return out;
                     }
                     GCBS_WARN("Dataset '" + gdal_file + "' will be ignored.");
                     out->set_status(chunk_data::chunk_status::INCOMPLETE);
+                    gdal_dataset_pool::instance()->release(dataset);
                     continue;
                 }
             }
-            GDALClose(dataset);
+            gdal_dataset_pool::instance()->release(dataset);
         }
         count_success++;
     }
@@ -25,10 +25,9 @@
 #include "stream.h"
 
 #include <stdlib.h>
-#include <fstream>
 #include <cstring>
 
-#include "external/tiny-process-library/process.hpp"
+#include "stream_process.h"
 
 namespace gdalcubes {
 
@@ -56,103 +55,32 @@ std::shared_ptr<chunk_data> stream_cube::stream_chunk_file(std::shared_ptr<chunk
         return out;
     }
 
-    // generate in and out filename
-    std::string f_in = filesystem::join(config::instance()->get_streaming_dir(), utils::generate_unique_filename(12, ".stream_" + std::to_string(id) + "_", "_in"));
-    std::string f_out = filesystem::join(config::instance()->get_streaming_dir(), utils::generate_unique_filename(12, ".stream_" + std::to_string(id) + "_", "_out"));
-
-    std::string errstr;  // capture error string
-
-    // write input data
-    std::ofstream f_in_stream(f_in, std::ios::out | std::ios::binary | std::ios::trunc);
-    if (!f_in_stream.is_open()) {
-        GCBS_ERROR("Cannot write streaming input data to file '" + f_in + "'");
-        throw std::string("ERROR in stream_cube::stream_chunk_file(): cannot write streaming input data to file '" + f_in + "'");
-    }
-
-    std::string proj = _in_cube->st_reference()->srs();
-    f_in_stream.write((char *)(size), sizeof(int) * 4);
-    for (uint16_t i = 0; i < _in_cube->bands().count(); ++i) {
-        int str_size = _in_cube->bands().get(i).name.size();
-        f_in_stream.write((char *)(&str_size), sizeof(int));
-        f_in_stream.write(_in_cube->bands().get(i).name.c_str(), sizeof(char) * str_size);
-    }
-
-    double *dims = (double *)std::calloc(size[1] + size[2] + size[3], sizeof(double));
-    int i = 0;
+    std::vector<double> dims;
     for (int it = 0; it < size[1]; ++it) {
-        dims[i] = (_in_cube->st_reference()->datetime_at_index(it + _in_cube->chunk_size()[0] * _in_cube->chunk_limits(id).low[0])).to_double();
-        ++i;
+        dims.push_back((_in_cube->st_reference()->datetime_at_index(it + _in_cube->chunk_size()[0] * _in_cube->chunk_limits(id).low[0])).to_double());
     }
     bounds_st cextent = this->bounds_from_chunk(id);  // implemented in derived classes
     for (int iy = 0; iy < size[2]; ++iy) {
-        dims[i] = cextent.s.top - (iy + 0.5) * st_reference()->dy();  // cell center
-        ++i;
+        dims.push_back(cextent.s.top - (iy + 0.5) * st_reference()->dy());  // cell center
     }
     for (int ix = 0; ix < size[3]; ++ix) {
-        dims[i] = cextent.s.left + (ix + 0.5) * st_reference()->dx();
-        ++i;
+        dims.push_back(cextent.s.left + (ix + 0.5) * st_reference()->dx());
     }
 
-    f_in_stream.write((char *)(dims), sizeof(double) * (size[1] + size[2] + size[3]));
-    std::free(dims);
-
-    int str_size = proj.size();
-    f_in_stream.write((char *)(&str_size), sizeof(int));
-    f_in_stream.write(proj.c_str(), sizeof(char) * str_size);
-    f_in_stream.write(((char *)(data->buf())), sizeof(double) * data->size()[0] * data->size()[1] * data->size()[2] * data->size()[3]);
-    f_in_stream.close();
-
-    /* setenv / _putenv is not thread-safe, we need to get a mutex until the child process has been started. */
-    static std::mutex mtx;
-    mtx.lock();
-    utils::env::instance().set({
-        {"GDALCUBES_STREAMING", "1"},
-        {"GDALCUBES_STREAMING_CHUNK_ID", std::to_string(id)},
-        {"GDALCUBES_STREAMING_FILE_IN", f_in},
-        {"GDALCUBES_STREAMING_FILE_OUT", f_out}});
-
-    // start process
-    TinyProcessLib::Process process(
-        _cmd, "", [](const char *bytes, std::size_t n) {}, [&errstr](const char *bytes, std::size_t n) {
-        errstr = std::string(bytes, n);
-        GCBS_DEBUG(errstr); }, false);
-    utils::env::instance().unset_all();
-    mtx.unlock();
-    auto exit_status = process.get_exit_status();
-    filesystem::remove(f_in);
-    if (exit_status != 0) {
-        GCBS_ERROR("Child process failed with exit code " + std::to_string(exit_status));
-        GCBS_ERROR("Child process output: " + errstr);
-        if (filesystem::exists(f_out)) {
-            filesystem::remove(f_out);
-        }
-        throw std::string("ERROR in stream_cube::read_chunk(): external program returned exit code " + std::to_string(exit_status));
-    }
-
-    // read output data
-    std::ifstream f_out_stream(f_out, std::ios::in | std::ios::binary);
-    if (!f_out_stream.is_open()) {
-        GCBS_ERROR("Cannot read streaming output data from file '" + f_out + "'");
-        throw std::string("ERROR in stream_cube::stream_chunk_file(): cannot read streaming output data from file '" + f_out + "'");
+    std::string header = stream_process::header(size, _in_cube->bands(), dims, _in_cube->st_reference()->srs());
+    std::string result = stream_process::exec(_cmd, id, header, (char *)(data->buf()),
+                                              sizeof(double) * data->size()[0] * data->size()[1] * data->size()[2] * data->size()[3]);
+    if (result.size() < 4 * sizeof(int)) {
+        return out;
     }
-
-    f_out_stream.seekg(0, f_out_stream.end);
-    int length = f_out_stream.tellg();
-    f_out_stream.seekg(0, f_out_stream.beg);
-    char *buffer = (char *)std::calloc(length, sizeof(char));
-    f_out_stream.read(buffer, length);
-    f_out_stream.close();
+    const char *buffer = result.data();
+    std::size_t length = result.size();
 
     chunk_size_btyx out_size = {(uint32_t)(((int *)buffer)[0]), (uint32_t)(((int *)buffer)[1]),
                                 (uint32_t)(((int *)buffer)[2]), (uint32_t)(((int *)buffer)[3])};
     out->size(out_size);
     out->buf(std::calloc(out_size[0] * out_size[1] * out_size[2] * out_size[3], sizeof(double)));
-    std::memcpy(out->buf(), buffer + (4 * sizeof(int)), length - 4 * sizeof(int));
-    std::free(buffer);
-
-    if (filesystem::exists(f_out)) {
-        filesystem::remove(f_out);
-    }
+    std::memcpy(out->buf(), buffer + (4 * sizeof(int)), std::min(length - 4 * sizeof(int), out_size[0] * out_size[1] * out_size[2] * out_size[3] * sizeof(double)));
 
     return out;
 }
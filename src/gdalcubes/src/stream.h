@@ -25,6 +25,7 @@
 #define STREAM_H
 
 #include "cube.h"
+#include "stream_process.h"
 
 namespace gdalcubes {
 
@@ -75,6 +76,7 @@ class stream_cube : public cube {
 
         std::shared_ptr<chunk_data> c0;
         c0 = stream_chunk_file(dummy_chunk, 0);
+        stream_process::stop(_cmd);  // chunks are computed later, possibly in other threads or processes
 
 
         for (uint16_t ib = 0; ib < c0->size()[0]; ++ib) {
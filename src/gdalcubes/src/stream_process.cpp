@@ -0,0 +1,365 @@
+/*
+    MIT License
+
+    Copyright (c) 2026 Marius Appel <marius.appel@hs-bochum.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "stream_process.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <stdlib.h>
+#else
+#include <pthread.h>
+#include <signal.h>
+#endif
+#ifdef __APPLE__
+#include <crt_externs.h>  // _NSGetEnviron()
+#elif !defined(_WIN32)
+extern char **environ;
+#endif
+
+#include "external/tiny-process-library/process.hpp"
+
+namespace gdalcubes {
+
+namespace {
+
+// Environment of child processes, i.e. the environment of the current process plus given variables. Passing an
+// explicit environment block instead of calling setenv / _putenv, which are not thread-safe, allows to start
+// processes from many threads in parallel.
+TinyProcessLib::Process::environment_type process_environment(std::map<std::string, std::string> vars) {
+    TinyProcessLib::Process::environment_type out;
+#if defined(_WIN32)
+    char **env = _environ;
+#elif defined(__APPLE__)
+    char **env = *_NSGetEnviron();
+#else
+    char **env = environ;
+#endif
+    for (; env && *env; ++env) {
+        std::string s(*env);
+        std::size_t pos = s.find('=', 1);  // on Windows, names of some variables start with '='
+        if (pos != std::string::npos) {
+            out[s.substr(0, pos)] = s.substr(pos + 1);
+        }
+    }
+    for (auto it = vars.begin(); it != vars.end(); ++it) {
+        out[it->first] = it->second;
+    }
+    return out;
+}
+
+std::unique_ptr<TinyProcessLib::Process> start_process(std::string cmd, std::map<std::string, std::string> vars,
+                                                       std::function<void(const char *, std::size_t)> read_stdout,
+                                                       std::function<void(const char *, std::size_t)> read_stderr,
+                                                       bool open_stdin) {
+    TinyProcessLib::Config pconf;
+    pconf.show_window = TinyProcessLib::Config::ShowWindow::hide;
+    return std::unique_ptr<TinyProcessLib::Process>(new TinyProcessLib::Process(cmd, "", process_environment(vars), read_stdout, read_stderr, open_stdin, pconf));
+}
+
+// Write to stdin of a child process without raising SIGPIPE if the child process does not exist anymore
+bool write_stdin(TinyProcessLib::Process &p, const char *bytes, std::size_t n) {
+#ifndef _WIN32
+    sigset_t set, old;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, &old);
+#endif
+    const std::size_t block_size = 1024 * 1024;
+    bool ok = true;
+    for (std::size_t i = 0; ok && i < n; i += block_size) {
+        ok = p.write(bytes + i, std::min(block_size, n - i));
+    }
+#ifndef _WIN32
+    sigset_t pending;
+    sigpending(&pending);
+    if (sigismember(&pending, SIGPIPE)) {
+        int sig;
+        sigwait(&set, &sig);
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+#endif
+    return ok;
+}
+
+/**
+ * An external process that is kept alive to process many chunks, see stream_process for the protocol
+ */
+class persistent_process {
+   public:
+    persistent_process(std::string cmd) : _out(), _err(), _mutex(), _cv(), _failed(false), _process() {
+        _process = start_process(
+            cmd, {{"GDALCUBES_STREAMING", "1"}, {"GDALCUBES_STREAMING_PERSISTENT", "1"}},
+            [this](const char *bytes, std::size_t n) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _out.append(bytes, n);
+                _cv.notify_all();
+            },
+            [this](const char *bytes, std::size_t n) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _err.append(bytes, n);
+            },
+            true);
+    }
+
+    ~persistent_process() {
+        // the process exits as soon as stdin has been closed
+        _process->close_stdin();
+        int exit_status;
+        for (uint16_t i = 0; i < 20; ++i) {
+            if (_process->try_get_exit_status(exit_status)) {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        _process->kill(true);
+        _process->get_exit_status();
+    }
+
+    // a process that failed once is not used for further chunks
+    inline bool failed() { return _failed; }
+
+    std::string exec(chunkid_t id, const std::string &header, const char *data, std::size_t nbytes) {
+        int32_t frame_id = id;
+        double frame_length = header.size() + nbytes;
+        if (!write_stdin(*_process, (char *)(&frame_id), sizeof(int32_t)) ||
+            !write_stdin(*_process, (char *)(&frame_length), sizeof(double)) ||
+            !write_stdin(*_process, header.data(), header.size()) ||
+            !write_stdin(*_process, data, nbytes)) {
+            fail("cannot write chunk data to external program");
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+            std::size_t pos = _out.find("GCST");
+            if (pos != 0 && pos != std::string::npos) {
+                GCBS_DEBUG(_out.substr(0, pos));
+                _out.erase(0, pos);
+                pos = 0;
+            }
+            if (pos == 0 && _out.size() >= 4 + sizeof(double)) {
+                double length;
+                std::memcpy(&length, _out.data() + 4, sizeof(double));
+                std::size_t end = 4 + sizeof(double) + (std::size_t)length;
+                if (_out.size() >= end) {
+                    std::string result = _out.substr(4 + sizeof(double), (std::size_t)length);
+                    _out.erase(0, end);
+                    if (!_err.empty()) {
+                        GCBS_DEBUG(_err);
+                        _err.clear();
+                    }
+                    return result;
+                }
+            }
+            if (_cv.wait_for(lock, std::chrono::milliseconds(100)) == std::cv_status::timeout) {
+                int exit_status;
+                if (_process->try_get_exit_status(exit_status)) {
+                    lock.unlock();
+                    fail("external program terminated with exit code " + std::to_string(exit_status));
+                }
+            }
+        }
+    }
+
+   private:
+    void fail(std::string msg) {
+        _failed = true;
+        std::lock_guard<std::mutex> lock(_mutex);
+        GCBS_ERROR("Child process output: " + _err);
+        throw std::string("ERROR in stream_process::exec(): " + msg);
+    }
+
+    std::string _out;
+    std::string _err;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _failed;
+    std::unique_ptr<TinyProcessLib::Process> _process;
+};
+
+/**
+ * Persistent processes by command and thread
+ */
+class persistent_process_pool {
+   public:
+    static persistent_process_pool *instance() {
+        static persistent_process_pool _instance;
+        return &_instance;
+    }
+
+    std::shared_ptr<persistent_process> get(std::string cmd) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto key = std::make_pair(cmd, std::this_thread::get_id());
+        auto it = _processes.find(key);
+        if (it != _processes.end() && !it->second->failed()) {
+            return it->second;
+        }
+        GCBS_DEBUG("Starting persistent external process '" + cmd + "'");
+        std::shared_ptr<persistent_process> p = std::make_shared<persistent_process>(cmd);
+        _processes[key] = p;
+        return p;
+    }
+
+    void remove(std::string cmd) {
+        std::shared_ptr<persistent_process> p;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _processes.find(std::make_pair(cmd, std::this_thread::get_id()));
+            if (it == _processes.end()) {
+                return;
+            }
+            p = it->second;
+            _processes.erase(it);
+        }
+        // the process is terminated here, without holding the mutex
+    }
+
+    void clear() {
+        std::map<std::pair<std::string, std::thread::id>, std::shared_ptr<persistent_process>> processes;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            processes.swap(_processes);
+        }
+        // processes are terminated here, without holding the mutex
+    }
+
+   private:
+    persistent_process_pool() : _processes(), _mutex() {}
+    persistent_process_pool(const persistent_process_pool &) = delete;
+
+    std::map<std::pair<std::string, std::thread::id>, std::shared_ptr<persistent_process>> _processes;
+    std::mutex _mutex;
+};
+
+}  // namespace
+
+std::string stream_process::header(int size[4], band_collection bands, std::vector<double> dims, std::string srs) {
+    std::ostringstream out(std::ios::out | std::ios::binary);
+    out.write((char *)(size), sizeof(int) * 4);
+    for (uint16_t i = 0; i < bands.count(); ++i) {
+        int str_size = bands.get(i).name.size();
+        out.write((char *)(&str_size), sizeof(int));
+        out.write(bands.get(i).name.c_str(), sizeof(char) * str_size);
+    }
+    out.write((char *)(dims.data()), sizeof(double) * dims.size());
+    int str_size = srs.size();
+    out.write((char *)(&str_size), sizeof(int));
+    out.write(srs.c_str(), sizeof(char) * str_size);
+    return out.str();
+}
+
+std::string stream_process::exec(std::string cmd, chunkid_t id, const std::string &header, const char *data, std::size_t nbytes) {
+    streaming_mode mode = config::instance()->get_streaming_mode();
+#ifdef _WIN32
+    mode = streaming_mode::FILES;  // results cannot be written to stdout from R on Windows
+#endif
+
+    if (mode == streaming_mode::PERSISTENT) {
+        return persistent_process_pool::instance()->get(cmd)->exec(id, header, data, nbytes);
+    }
+
+    std::string errstr;  // capture error string
+    std::string result;
+    if (mode == streaming_mode::PIPE) {
+        std::unique_ptr<TinyProcessLib::Process> process = start_process(
+            cmd, {{"GDALCUBES_STREAMING", "1"}, {"GDALCUBES_STREAMING_CHUNK_ID", std::to_string(id)}},
+            [&result](const char *bytes, std::size_t n) { result.append(bytes, n); },
+            [&errstr](const char *bytes, std::size_t n) { errstr.append(bytes, n); }, true);
+        bool ok = write_stdin(*process, header.data(), header.size()) && write_stdin(*process, data, nbytes);
+        process->close_stdin();
+        auto exit_status = process->get_exit_status();
+        if (exit_status != 0 || !ok) {
+            GCBS_ERROR("Child process failed with exit code " + std::to_string(exit_status));
+            GCBS_ERROR("Child process output: " + errstr);
+            throw std::string("ERROR in stream_process::exec(): external program returned exit code " + std::to_string(exit_status));
+        }
+        GCBS_DEBUG(errstr);
+        return result;
+    }
+
+    // generate in and out filename
+    std::string f_in = filesystem::join(config::instance()->get_streaming_dir(), utils::generate_unique_filename(12, ".stream_" + std::to_string(id) + "_", "_in"));
+    std::string f_out = filesystem::join(config::instance()->get_streaming_dir(), utils::generate_unique_filename(12, ".stream_" + std::to_string(id) + "_", "_out"));
+
+    // write input data
+    std::ofstream f_in_stream(f_in, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!f_in_stream.is_open()) {
+        GCBS_ERROR("Cannot write streaming input data to file '" + f_in + "'");
+        throw std::string("ERROR in stream_process::exec(): cannot write streaming input data to file '" + f_in + "'");
+    }
+    f_in_stream.write(header.data(), header.size());
+    f_in_stream.write(data, nbytes);
+    f_in_stream.close();
+
+    // start process
+    std::unique_ptr<TinyProcessLib::Process> process = start_process(
+        cmd, {{"GDALCUBES_STREAMING", "1"}, {"GDALCUBES_STREAMING_CHUNK_ID", std::to_string(id)}, {"GDALCUBES_STREAMING_FILE_IN", f_in}, {"GDALCUBES_STREAMING_FILE_OUT", f_out}},
+        [](const char *bytes, std::size_t n) {},
+        [&errstr](const char *bytes, std::size_t n) { errstr.append(bytes, n); }, false);
+    auto exit_status = process->get_exit_status();
+    filesystem::remove(f_in);
+    if (exit_status != 0) {
+        GCBS_ERROR("Child process failed with exit code " + std::to_string(exit_status));
+        GCBS_ERROR("Child process output: " + errstr);
+        if (filesystem::exists(f_out)) {
+            filesystem::remove(f_out);
+        }
+        throw std::string("ERROR in stream_process::exec(): external program returned exit code " + std::to_string(exit_status));
+    }
+    GCBS_DEBUG(errstr);
+
+    // read output data
+    std::ifstream f_out_stream(f_out, std::ios::in | std::ios::binary);
+    if (!f_out_stream.is_open()) {
+        GCBS_ERROR("Cannot read streaming output data from file '" + f_out + "'");
+        throw std::string("ERROR in stream_process::exec(): cannot read streaming output data from file '" + f_out + "'");
+    }
+    f_out_stream.seekg(0, f_out_stream.end);
+    std::streamoff length = f_out_stream.tellg();
+    f_out_stream.seekg(0, f_out_stream.beg);
+    result.resize(length);
+    f_out_stream.read(&result[0], length);
+    f_out_stream.close();
+    filesystem::remove(f_out);
+    return result;
+}
+
+void stream_process::stop(std::string cmd) {
+    persistent_process_pool::instance()->remove(cmd);
+}
+
+void stream_process::stop_all() {
+    persistent_process_pool::instance()->clear();
+}
+
+}  // namespace gdalcubes
@@ -0,0 +1,96 @@
+/*
+    MIT License
+
+    Copyright (c) 2026 Marius Appel <marius.appel@hs-bochum.de>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef STREAM_PROCESS_H
+#define STREAM_PROCESS_H
+
+#include <string>
+#include <vector>
+
+#include "cube.h"
+
+namespace gdalcubes {
+
+/**
+ * @brief Helper functions to pass chunks to external programs and to read their results
+ *
+ * Chunks are serialized in a simple binary format: the size of the chunk (4 x int32, b, t, y, x), band names
+ * (int32 length + characters for each band), dimension values (t, y, and x as doubles), the spatial reference
+ * system (int32 length + characters), and finally the chunk values as doubles. External programs return results as
+ * the size of the result (4 x int32) followed by the values as doubles.
+ *
+ * How data is exchanged with external programs depends on config::get_streaming_mode():
+ *
+ * - streaming_mode::FILES: input and output are written to files in the streaming directory, whose names are passed
+ *   as environment variables GDALCUBES_STREAMING_FILE_IN and GDALCUBES_STREAMING_FILE_OUT, one process per chunk
+ * - streaming_mode::PIPE: input is written to stdin and output is read from stdout, one process per chunk
+ * - streaming_mode::PERSISTENT: one process per command and thread is kept alive and processes many chunks, see below
+ *
+ * In persistent mode, the environment variable GDALCUBES_STREAMING_PERSISTENT is set to "1" and the external program
+ * must read frames from stdin until it is closed. A frame consists of the chunk id (int32), the length of the
+ * serialized chunk in bytes (double), and the serialized chunk. For each frame, the program must write
+ * the characters "GCST", the length of its output in bytes (double), and the output itself to stdout, where an output
+ * of length zero denotes an empty chunk. Any other data before "GCST" is ignored.
+ *
+ * On Windows, chunks are always passed as files.
+ */
+class stream_process {
+   public:
+    /**
+     * @brief Serialize everything of a chunk but its values
+     * @param size size of the chunk (b, t, y, x)
+     * @param bands bands of the chunk
+     * @param dims dimension values, datetime of time slices as returned from datetime::to_double(),
+     * followed by y and x coordinates of cell centers
+     * @param srs spatial reference system of the chunk
+     * @return serialized header
+     */
+    static std::string header(int size[4], band_collection bands, std::vector<double> dims, std::string srs);
+
+    /**
+     * @brief Pass a chunk to an external program and return its output
+     * @param cmd external program call
+     * @param id chunk id, passed to the external program
+     * @param header serialized chunk header, see header()
+     * @param data pointer to chunk values
+     * @param nbytes size of chunk values in bytes
+     * @return output of the external program, i.e. the size of the result (4 x int32) followed by its values,
+     * possibly empty
+     */
+    static std::string exec(std::string cmd, chunkid_t id, const std::string &header, const char *data, std::size_t nbytes);
+
+    /**
+     * @brief Terminate the persistent external process of the calling thread for a given command, if any
+     * @param cmd external program call
+     */
+    static void stop(std::string cmd);
+
+    /**
+     * @brief Terminate all persistent external processes
+     */
+    static void stop_all();
+};
+
+}  // namespace gdalcubes
+
+#endif  //STREAM_PROCESS_H
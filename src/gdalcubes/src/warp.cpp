@@ -24,6 +24,7 @@
 
 #include "warp.h"
 
+#include <cstdio>
 #include <gdalwarper.h>
 
 #include "config.h"
@@ -47,23 +48,183 @@ gdalwarp_client::gdalcubes_reprojection_info *gdalwarp_client::gdal_transformati
     return pt;
 }
 
+bool gdalwarp_client::gdal_transformation_cache::transform(std::string srs_in_str, std::string srs_out_str, int n, double *x, double *y, int *success) {
+    auto q = std::pair<std::string, std::string>(srs_in_str, srs_out_str);
+
+    std::shared_ptr<point_transform> pt;
+    _mutex.lock();
+    auto it = _point_transforms.find(q);
+    if (it != _point_transforms.end()) {
+        pt = it->second;
+    } else {
+        pt = std::make_shared<point_transform>();
+        OGRSpatialReference srs_in;
+        OGRSpatialReference srs_out;
+        srs_in.SetFromUserInput(srs_in_str.c_str());
+        srs_out.SetFromUserInput(srs_out_str.c_str());
+        if (srs_in.IsSame(&srs_out)) {
+            pt->identity = true;
+        } else {
+            pt->ct = OGRCreateCoordinateTransformation(&srs_in, &srs_out);
+        }
+        // failures are cached, too
+        _point_transforms.insert(std::make_pair(q, pt));
+    }
+    _mutex.unlock();
+
+    if (pt->identity) {
+        if (success) std::fill(success, success + n, TRUE);
+        return true;
+    }
+    if (!pt->ct) {
+        if (success) std::fill(success, success + n, FALSE);
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(pt->mutex);
+    return pt->ct->Transform(n, x, y, nullptr, success);
+}
+
 gdalwarp_client::gdal_transformation_cache::~gdal_transformation_cache() {
     //GCBS_INFO("CACHE HAS " + std::to_string(_cache.size()) + " reprojections");
     for (auto it = _cache.begin(); it != _cache.end(); ++it) {
         destroy_reprojection(it->second);
     }
+    for (auto it = _point_transforms.begin(); it != _point_transforms.end(); ++it) {
+        if (it->second->ct) OCTDestroyCoordinateTransformation(it->second->ct);
+    }
+}
+
+bool transform_points(const std::string &srs_from, const std::string &srs_to, uint32_t n, double *x, double *y, int *success) {
+    return gdalwarp_client::gdal_transformation_cache::instance()->transform(srs_from, srs_to, (int)n, x, y, success);
+}
+
+
+std::vector<std::pair<int, int>> gdalwarp_client::overview_cache::levels(GDALDataset *in) {
+    std::string descr = in->GetDescription();
+    if (!descr.empty()) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto x = _levels.find(descr);
+        if (x != _levels.end()) {
+            return x->second;
+        }
+    }
+    std::vector<std::pair<int, int>> out;
+    GDALRasterBand *b = in->GetRasterBand(1);
+    if (b) {
+        for (int i = 0; i < b->GetOverviewCount(); ++i) {
+            GDALRasterBand *ov = b->GetOverview(i);
+            if (!ov) break;
+            out.push_back(std::make_pair(ov->GetXSize(), ov->GetYSize()));
+        }
+    }
+    if (!descr.empty()) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _levels[descr] = out;
+    }
+    return out;
+}
+
+bool gdalwarp_client::overview_cache::get_choice(std::string key, int16_t &level) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto x = _choices.find(key);
+    if (x == _choices.end()) {
+        return false;
+    }
+    level = x->second;
+    return true;
+}
+
+void gdalwarp_client::overview_cache::put_choice(std::string key, int16_t level) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _choices[key] = level;
+}
+
+void gdalwarp_client::overview_cache::remove(std::string descr) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _levels.erase(descr);
+    // choices are identified by description, target SRS and resolution
+    std::string prefix = descr + "|";
+    for (auto it = _choices.lower_bound(prefix); it != _choices.end() && it->first.compare(0, prefix.size(), prefix) == 0;) {
+        it = _choices.erase(it);
+    }
+}
+
+void gdalwarp_client::overview_cache::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _levels.clear();
+    _choices.clear();
+}
+
+int16_t gdalwarp_client::select_overview_level(GDALDataset *in, std::string t_srs, double *dst_geotransform, uint32_t ts_x, uint32_t ts_y, void *transformer_arg, GDALTransformerFunc transformer) {
+    std::vector<std::pair<int, int>> levels = overview_cache::instance()->levels(in);
+    if (levels.empty()) {
+        return -1;
+    }
+
+    // the chosen level only depends on the dataset and the target SRS and resolution, not on the particular chunk
+    std::string key = "";
+    std::string descr = in->GetDescription();
+    if (!descr.empty()) {
+        // std::to_string() rounds to 6 decimal places, which is not enough to distinguish resolutions in degrees
+        char res[64];
+        std::snprintf(res, sizeof(res), "%.17g|%.17g", dst_geotransform[1], dst_geotransform[5]);
+        key = descr + "|" + t_srs + "|" + res;
+        int16_t ilevel;
+        if (overview_cache::instance()->get_choice(key, ilevel)) {
+            return ilevel;
+        }
+    }
+
+    double x[4] = {0, 0, double(ts_x), double(ts_x)};
+    double y[4] = {double(ts_y), 0, double(ts_y), 0};
+    int succ[4];
+    transformer(transformer_arg, 1, 4, x, y, NULL, succ);
+
+    double minx = std::min(std::min(x[0], x[1]), std::min(x[2], x[3]));
+    double maxx = std::max(std::max(x[0], x[1]), std::max(x[2], x[3]));
+    double target_ratio = (maxx - minx) / double(ts_x);
+
+    int16_t n_ov = levels.size();
+    int16_t ilevel = 0;
+    while (ilevel < n_ov) {
+        double ov_ratio = double(in->GetRasterBand(1)->GetXSize()) / double(levels[ilevel].first);
+        if (ov_ratio > target_ratio) {
+            --ilevel;
+            break;
+        }
+        ++ilevel;
+    }
+    if (ilevel >= n_ov) {
+        ilevel = n_ov - 1;
+    }
+    if (!key.empty()) {
+        overview_cache::instance()->put_choice(key, ilevel);
+    }
+    return ilevel;
+}
+
+GDALDataset *gdalwarp_client::open_overview(GDALDataset *in, int16_t level) {
+#if GDAL_VERSION_MAJOR > 2 || (GDAL_VERSION_MAJOR == 2 && GDAL_VERSION_MINOR >= 2)
+    return GDALCreateOverviewDataset(in, level, true);
+#else
+    char **oo = nullptr;
+    oo = CSLAddString(oo, ("OVERVIEW_LEVEL=" + std::to_string(level)).c_str());
+    GDALDataset *out = (GDALDataset *)GDALOpenEx(in->GetDescription(), GDAL_OF_RASTER | GDAL_OF_READONLY, NULL, oo, NULL);
+    CSLDestroy(oo);
+    return out;
+#endif
 }
 
 
 GDALDataset *gdalwarp_client::warp(GDALDataset *in, std::string s_srs, std::string t_srs, double te_left,
                                    double te_right, double te_top, double te_bottom, uint32_t ts_x, uint32_t ts_y,
-                                   std::string resampling, std::vector<double> srcnodata) {
+                                   std::string resampling, std::vector<double> srcnodata, std::vector<uint16_t> bands) {
     double temp[6];                                
     if (in->GetGeoTransform(temp) == CE_None) {
-        return warp_simple(in, s_srs, t_srs, te_left, te_right, te_top, te_bottom, ts_x, ts_y, resampling, srcnodata);
+        return warp_simple(in, s_srs, t_srs, te_left, te_right, te_top, te_bottom, ts_x, ts_y, resampling, srcnodata, bands);
     }
     else  { // GCPs, RCPs, or GeolocationArrays
-        return warp_complex(in, s_srs, t_srs, te_left, te_right, te_top, te_bottom, ts_x, ts_y, resampling, srcnodata);
+        return warp_complex(in, s_srs, t_srs, te_left, te_right, te_top, te_bottom, ts_x, ts_y, resampling, srcnodata, bands);
     }
 }
 
@@ -72,7 +233,12 @@ GDALDataset *gdalwarp_client::warp(GDALDataset *in, std::string s_srs, std::stri
 
 GDALDataset *gdalwarp_client::warp_simple(GDALDataset *in, std::string s_srs, std::string t_srs, double te_left,
                                    double te_right, double te_top, double te_bottom, uint32_t ts_x, uint32_t ts_y,
-                                   std::string resampling, std::vector<double> srcnodata) {
+                                   std::string resampling, std::vector<double> srcnodata, std::vector<uint16_t> bands) {
+    if (bands.empty()) {
+        for (uint16_t i = 0; i < in->GetRasterCount(); ++i) {
+            bands.push_back(i + 1);
+        }
+    }
     char *wkt_out = NULL;
 
     OGRSpatialReference srs_out;
@@ -93,7 +259,7 @@ GDALDataset *gdalwarp_client::warp_simple(GDALDataset *in, std::string s_srs, st
         throw std::string("Cannot find GDAL MEM driver");
     }
 
-    GDALDataset *out = mem_driver->Create("", ts_x, ts_y, in->GetRasterCount(), GDT_Float64, NULL);
+    GDALDataset *out = mem_driver->Create("", ts_x, ts_y, bands.size(), GDT_Float64, NULL);
 
     out->SetProjection(wkt_out);
     out->SetGeoTransform(dst_geotransform);
@@ -121,58 +287,19 @@ GDALDataset *gdalwarp_client::warp_simple(GDALDataset *in, std::string s_srs, st
     psWarpOptions->pfnTransformer = transform;
 
     // Derive best overview level to use
-    int n_ov = in->GetRasterBand(1)->GetOverviewCount();
-    if (config::instance()->get_gdal_use_overviews() && n_ov > 0) {
-        double *x = (double *)std::malloc(sizeof(double) * 4);
-        double *y = (double *)std::malloc(sizeof(double) * 4);
-        int *succ = (int *)std::malloc(sizeof(int) * 4);
-        x[0] = 0;
-        x[1] = 0;
-        x[2] = ts_x;
-        x[3] = ts_x;
-        y[0] = ts_y;
-        y[1] = 0;
-        y[2] = ts_y;
-        y[3] = 0;
-        transform(psWarpOptions->pTransformerArg, 1, 4, x, y, NULL, succ);
-
-        double minx = std::min(std::min(x[0], x[1]), std::min(x[2], x[3]));
-        double maxx = std::max(std::max(x[0], x[1]), std::max(x[2], x[3]));
-        double target_ratio = (maxx - minx) / double(ts_x);
-
-        int16_t ilevel = 0;
-        while (ilevel < n_ov) {
-            double ov_ratio = double(in->GetRasterBand(1)->GetXSize()) / double(in->GetRasterBand(1)->GetOverview(ilevel)->GetXSize());
-            if (ov_ratio > target_ratio) {
-                --ilevel;
-                break;
-            }
-            ++ilevel;
-        }
-        if (ilevel >= n_ov) {
-            ilevel = n_ov - 1;
-        }
+    GDALDataset *in_ov = nullptr;  // overview dataset, if used
+    if (config::instance()->get_gdal_use_overviews()) {
+        int16_t ilevel = select_overview_level(in, t_srs, dst_geotransform, ts_x, ts_y, psWarpOptions->pTransformerArg, transform);
         if (ilevel >= 0) {
-            //GCBS_TRACE("Using overview level" + std::to_string(ilevel));
-            char **oo = nullptr;
-            oo = CSLAddString(oo, ("OVERVIEW_LEVEL=" + std::to_string(ilevel)).c_str());
-
-            std::string descr = in->GetDescription();
-            GDALClose(in);
-            in = (GDALDataset *)GDALOpenEx(descr.c_str(), GDAL_OF_RASTER | GDAL_OF_READONLY, NULL, oo, NULL);
-            if (in != NULL) {
+            in_ov = open_overview(in, ilevel);
+            if (in_ov != NULL) {
                 destroy_transform((gdalwarp_client::gdalcubes_transform_info *)psWarpOptions->pTransformerArg);
-                psWarpOptions->pTransformerArg = create_transform(in, out, s_srs, t_srs);
-                psWarpOptions->hSrcDS = in;  // TODO: close in_ov
+                psWarpOptions->pTransformerArg = create_transform(in_ov, out, s_srs, t_srs);
+                psWarpOptions->hSrcDS = in_ov;
             } else {
-                GCBS_WARN("Failed to open GDAL overview dataset for '" + descr + "', using original full resolution image.");
+                GCBS_WARN("Failed to open GDAL overview dataset for '" + std::string(in->GetDescription()) + "', using original full resolution image.");
             }
-            CSLDestroy(oo);
         }
-
-        std::free(x);
-        std::free(y);
-        std::free(succ);
     }
 
     psWarpOptions->eResampleAlg = GDALResampleAlg::GRA_NearestNeighbour;
@@ -200,7 +327,7 @@ GDALDataset *gdalwarp_client::warp_simple(GDALDataset *in, std::string s_srs, st
         psWarpOptions->eResampleAlg = GDALResampleAlg::GRA_Q3;
     }
 
-    psWarpOptions->nBandCount = in->GetRasterCount();
+    psWarpOptions->nBandCount = bands.size();
     psWarpOptions->panSrcBands = (int *)CPLMalloc(sizeof(int) * psWarpOptions->nBandCount);
     psWarpOptions->panDstBands = (int *)CPLMalloc(sizeof(int) * psWarpOptions->nBandCount);
     double *dst_nodata = (double *)CPLMalloc(sizeof(double) * psWarpOptions->nBandCount);
@@ -211,7 +338,7 @@ GDALDataset *gdalwarp_client::warp_simple(GDALDataset *in, std::string s_srs, st
     for (uint16_t i = 0; i < psWarpOptions->nBandCount; ++i) {
         dst_nodata[i] = NAN;
         dst_nodata_img[i] = 0.0;
-        psWarpOptions->panSrcBands[i] = i + 1;
+        psWarpOptions->panSrcBands[i] = bands[i];
         psWarpOptions->panDstBands[i] = i + 1;
     }
     double *src_nodata = nullptr;
@@ -260,8 +387,8 @@ GDALDataset *gdalwarp_client::warp_simple(GDALDataset *in, std::string s_srs, st
 
     CPLFree(wkt_out);
 
-    if (in) {
-        GDALClose(in);
+    if (in_ov) {
+        GDALClose(in_ov);
     }
     return out;
 }
@@ -435,7 +562,12 @@ void gdalwarp_client::destroy_reprojection(gdalcubes_reprojection_info *reprojec
 
 GDALDataset *gdalwarp_client::warp_complex(GDALDataset *in, std::string s_srs, std::string t_srs, double te_left,
                                    double te_right, double te_top, double te_bottom, uint32_t ts_x, uint32_t ts_y,
-                                   std::string resampling, std::vector<double> srcnodata) {
+                                   std::string resampling, std::vector<double> srcnodata, std::vector<uint16_t> bands) {
+    if (bands.empty()) {
+        for (uint16_t i = 0; i < in->GetRasterCount(); ++i) {
+            bands.push_back(i + 1);
+        }
+    }
     char *wkt_out = NULL;
 
     OGRSpatialReference srs_out;
@@ -456,9 +588,9 @@ GDALDataset *gdalwarp_client::warp_complex(GDALDataset *in, std::string s_srs, s
         throw std::string("Cannot find GDAL MEM driver");
     }
 
-    GDALDataset *out = mem_driver->Create("", ts_x, ts_y, in->GetRasterCount(), GDT_Float64, NULL);
+    GDALDataset *out = mem_driver->Create("", ts_x, ts_y, bands.size(), GDT_Float64, NULL);
 
-    for (uint16_t i=0; i<in->GetRasterCount(); ++i) {
+    for (uint16_t i=0; i<bands.size(); ++i) {
         out->GetRasterBand(i+1)->Fill(NAN); // Avoid spurious output when warping fails.
     }
 
@@ -512,60 +644,31 @@ GDALDataset *gdalwarp_client::warp_complex(GDALDataset *in, std::string s_srs, s
     psWarpOptions->pfnTransformer = GDALGenImgProjTransform;
 
     // Derive best overview level to use
-    int n_ov = in->GetRasterBand(1)->GetOverviewCount();
-    if (config::instance()->get_gdal_use_overviews() && n_ov > 0) {
-        double *x = (double *)std::malloc(sizeof(double) * 4);
-        double *y = (double *)std::malloc(sizeof(double) * 4);
-        int *succ = (int *)std::malloc(sizeof(int) * 4);
-        x[0] = 0;
-        x[1] = 0;
-        x[2] = ts_x;
-        x[3] = ts_x;
-        y[0] = ts_y;
-        y[1] = 0;
-        y[2] = ts_y;
-        y[3] = 0;
-
-        // Transform corners
-        GDALGenImgProjTransform(psWarpOptions->pTransformerArg, 1, 4, x, y, NULL, succ);
-
-        double minx = std::min(std::min(x[0], x[1]), std::min(x[2], x[3]));
-        double maxx = std::max(std::max(x[0], x[1]), std::max(x[2], x[3]));
-        double target_ratio = (maxx - minx) / double(ts_x);
-
-        int16_t ilevel = 0;
-        while (ilevel < n_ov) {
-            double ov_ratio = double(in->GetRasterBand(1)->GetXSize()) / double(in->GetRasterBand(1)->GetOverview(ilevel)->GetXSize());
-            if (ov_ratio > target_ratio) {
-                --ilevel;
-                break;
-            }
-            ++ilevel;
-        }
-        if (ilevel >= n_ov) {
-            ilevel = n_ov - 1;
-        }
+    GDALDataset *in_ov = nullptr;  // overview dataset, if used
+    if (config::instance()->get_gdal_use_overviews()) {
+        int16_t ilevel = select_overview_level(in, t_srs, dst_geotransform, ts_x, ts_y, psWarpOptions->pTransformerArg, GDALGenImgProjTransform);
         if (ilevel >= 0) {
-            //GCBS_TRACE("Using overview level" + std::to_string(ilevel));
-            char **oo = nullptr;
-            oo = CSLAddString(oo, ("OVERVIEW_LEVEL=" + std::to_string(ilevel)).c_str());
-
-            std::string descr = in->GetDescription();
-            GDALClose(in);
-            in = (GDALDataset *)GDALOpenEx(descr.c_str(), GDAL_OF_RASTER | GDAL_OF_READONLY, NULL, oo, NULL);
-            if (in != NULL) {
-                destroy_transform((gdalwarp_client::gdalcubes_transform_info *)psWarpOptions->pTransformerArg);
-                psWarpOptions->pTransformerArg = create_transform(in, out, s_srs, t_srs);
-                psWarpOptions->hSrcDS = in;  // TODO: close in_ov
+            in_ov = open_overview(in, ilevel);
+            if (in_ov != NULL) {
+                // recreate the transformer for the overview dataset
+                psInfo->pReprojectArg = tmparg;
+                GDALDestroyGenImgProjTransformer(psInfo);
+                psInfo = static_cast<GDALGenImgProjTransformInfo *>(GDALCreateGenImgProjTransformer2(in_ov, out, trnsfrm_opts.List()));
+                if (!psInfo) {
+                    GCBS_ERROR("Cannot find coordinate transformation from input image to target data cube");
+                    throw std::string("Cannot find coordinate transformation from input image to target data cube");
+                }
+                tmparg = psInfo->pReprojectArg;
+                if (!srs_in.IsSame(&srs_out)) {
+                    psInfo->pReprojectArg = gdal_transformation_cache::instance()->get(s_srs, t_srs);
+                    psInfo->pReproject = reproject;
+                }
+                psWarpOptions->pTransformerArg = (void *)psInfo;
+                psWarpOptions->hSrcDS = in_ov;
             } else {
-                GCBS_WARN("Failed to open GDAL overview dataset for '" + descr + "', using original full resolution image.");
+                GCBS_WARN("Failed to open GDAL overview dataset for '" + std::string(in->GetDescription()) + "', using original full resolution image.");
             }
-            CSLDestroy(oo);
         }
-
-        std::free(x);
-        std::free(y);
-        std::free(succ);
     }
 
     psWarpOptions->eResampleAlg = GDALResampleAlg::GRA_NearestNeighbour;
@@ -593,7 +696,7 @@ GDALDataset *gdalwarp_client::warp_complex(GDALDataset *in, std::string s_srs, s
         psWarpOptions->eResampleAlg = GDALResampleAlg::GRA_Q3;
     }
 
-    psWarpOptions->nBandCount = in->GetRasterCount();
+    psWarpOptions->nBandCount = bands.size();
     psWarpOptions->panSrcBands = (int *)CPLMalloc(sizeof(int) * psWarpOptions->nBandCount);
     psWarpOptions->panDstBands = (int *)CPLMalloc(sizeof(int) * psWarpOptions->nBandCount);
     double *dst_nodata = (double *)CPLMalloc(sizeof(double) * psWarpOptions->nBandCount);
@@ -604,7 +707,7 @@ GDALDataset *gdalwarp_client::warp_complex(GDALDataset *in, std::string s_srs, s
     for (uint16_t i = 0; i < psWarpOptions->nBandCount; ++i) {
         dst_nodata[i] = NAN;
         dst_nodata_img[i] = 0.0;
-        psWarpOptions->panSrcBands[i] = i + 1;
+        psWarpOptions->panSrcBands[i] = bands[i];
         psWarpOptions->panDstBands[i] = i + 1;
     }
     double *src_nodata = nullptr;
@@ -661,8 +764,8 @@ GDALDataset *gdalwarp_client::warp_complex(GDALDataset *in, std::string s_srs, s
 
     CPLFree(wkt_out);
 
-    if (in) {
-        GDALClose(in);
+    if (in_ov) {
+        GDALClose(in_ov);
     }
     return out;
 }
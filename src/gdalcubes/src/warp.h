@@ -66,6 +66,16 @@ class gdalwarp_client {
 
         gdalcubes_reprojection_info *get(std::string srs_in_str, std::string srs_out_str);
 
+        /**
+         * Transform points in place with a cached transformation from srs_in_str to srs_out_str
+         * @param n number of points
+         * @param x x coordinates
+         * @param y y coordinates
+         * @param success per point success flags, may be nullptr
+         * @return false if the transformation could not be created or failed for at least one point
+         */
+        bool transform(std::string srs_in_str, std::string srs_out_str, int n, double *x, double *y, int *success = nullptr);
+
        private:
         gdal_transformation_cache(const gdal_transformation_cache &) = delete;
         gdal_transformation_cache(gdal_transformation_cache &&) = delete;
@@ -76,12 +86,65 @@ class gdalwarp_client {
 
         std::map<std::pair<std::string, std::string>, gdalcubes_reprojection_info *> _cache;
         std::mutex _mutex;
+
+        // Transformations for transform() are separate from those used for warping, as they must be locked during use
+        struct point_transform {
+            OGRCoordinateTransformation *ct = nullptr;
+            bool identity = false;
+            std::mutex mutex;
+        };
+        std::map<std::pair<std::string, std::string>, std::shared_ptr<point_transform>> _point_transforms;
+    };
+
+    /**
+     * Cache for overview pyramid metadata of source datasets and for the overview level chosen for a given target grid,
+     * such that the level must not be derived for each chunk
+     */
+    class overview_cache {
+       public:
+        static overview_cache *instance() {
+            static overview_cache instance;
+            return &instance;
+        }
+
+        /**
+         * Get sizes of all overview levels of the first band of a dataset, datasets are identified by their description
+         * @param in GDAL dataset
+         * @return vector of (x, y) sizes of overview levels, empty if the dataset has no overviews
+         */
+        std::vector<std::pair<int, int>> levels(GDALDataset *in);
+
+        bool get_choice(std::string key, int16_t &level);
+        void put_choice(std::string key, int16_t level);
+
+        /**
+         * Remove cached entries of a dataset, e.g. because the file has been modified
+         * @param descr dataset description
+         */
+        void remove(std::string descr);
+
+        /**
+         * Remove all cached entries
+         */
+        void clear();
+
+       private:
+        overview_cache(const overview_cache &) = delete;
+        overview_cache(overview_cache &&) = delete;
+        overview_cache &operator=(const overview_cache &) = delete;
+        overview_cache &operator=(overview_cache &&) = delete;
+        overview_cache() {}
+        ~overview_cache() {}
+
+        std::map<std::string, std::vector<std::pair<int, int>>> _levels;
+        std::map<std::string, int16_t> _choices;
+        std::mutex _mutex;
     };
 
    public:
     /**
      * Warp source GDAL dataset to a target grid
-     * @param in source GDAL dataset, will be closed at the end of this function
+     * @param in source GDAL dataset, will NOT be closed, i.e. the caller keeps ownership
      * @param s_srs spatial reference system of source image, given as string understandable for OGRSpatialReference::SetFromUserInput()
      * @param t_srs target spatial reference system, given as string understandable for OGRSpatialReference::SetFromUserInput()
      * @param te_left left (minimum x) coordinate of the target grid, given in the target SRS
@@ -91,17 +154,40 @@ class gdalwarp_client {
      * @param ts_x number of pixels of the target grid in x direction
      * @param ts_y number of pixels of the target grid in y direction
      * @param resampling  resampling method, given as a string (see https://gdal.org/programs/gdalwarp.html#cmdoption-gdalwarp-r for possible options)
-     * @param srcnodata vector with no data values of the source dataset per band
-     * @return A new in-memory GDALDataset object
+     * @param srcnodata vector with no data values of the source dataset per (selected) band
+     * @param bands source band numbers (starting with 1) to be warped, if empty, all bands will be used
+     * @return A new in-memory GDALDataset object, where band i corresponds to the i-th selected source band
      */
-    static GDALDataset *warp(GDALDataset *in, std::string s_srs, std::string t_srs, double te_left, double te_right, double te_top, double te_bottom, uint32_t ts_x, uint32_t ts_y, std::string resampling, std::vector<double> srcnodata);
+    static GDALDataset *warp(GDALDataset *in, std::string s_srs, std::string t_srs, double te_left, double te_right, double te_top, double te_bottom, uint32_t ts_x, uint32_t ts_y, std::string resampling, std::vector<double> srcnodata, std::vector<uint16_t> bands = {});
 
     
     // See above, only for cases where source dataset has a GeoTransform (affine transformation)
-    static GDALDataset *warp_simple(GDALDataset *in, std::string s_srs, std::string t_srs, double te_left, double te_right, double te_top, double te_bottom, uint32_t ts_x, uint32_t ts_y, std::string resampling, std::vector<double> srcnodata);
+    static GDALDataset *warp_simple(GDALDataset *in, std::string s_srs, std::string t_srs, double te_left, double te_right, double te_top, double te_bottom, uint32_t ts_x, uint32_t ts_y, std::string resampling, std::vector<double> srcnodata, std::vector<uint16_t> bands = {});
 
     // See above, but also working for source images with spatial reference by GCPs, RPCs, or GeoLocation arrays
-    static GDALDataset *warp_complex(GDALDataset *in, std::string s_srs, std::string t_srs, double te_left, double te_right, double te_top, double te_bottom, uint32_t ts_x, uint32_t ts_y, std::string resampling, std::vector<double> srcnodata);
+    static GDALDataset *warp_complex(GDALDataset *in, std::string s_srs, std::string t_srs, double te_left, double te_right, double te_top, double te_bottom, uint32_t ts_x, uint32_t ts_y, std::string resampling, std::vector<double> srcnodata, std::vector<uint16_t> bands = {});
+
+    /**
+     * Select the overview level of a source dataset that is best suited to warp to a target grid, i.e., the coarsest
+     * level with a resolution not coarser than the target resolution
+     * @param in source GDAL dataset
+     * @param t_srs target spatial reference system
+     * @param dst_geotransform affine transformation of the target grid
+     * @param ts_x number of pixels of the target grid in x direction
+     * @param ts_y number of pixels of the target grid in y direction
+     * @param transformer_arg transformer from target to source pixel coordinates
+     * @param transformer transformer function
+     * @return overview level (starting with 0) or -1 if the full resolution dataset should be used
+     */
+    static int16_t select_overview_level(GDALDataset *in, std::string t_srs, double *dst_geotransform, uint32_t ts_x, uint32_t ts_y, void *transformer_arg, GDALTransformerFunc transformer);
+
+    /**
+     * Create a dataset for one overview level of an already opened dataset, without opening the underlying file again
+     * @param in GDAL dataset, must not be closed before the returned dataset has been closed
+     * @param level overview level (starting with 0)
+     * @return overview dataset or nullptr, must be closed with GDALClose()
+     */
+    static GDALDataset *open_overview(GDALDataset *in, int16_t level);
 
     static gdalcubes_transform_info *create_transform(GDALDataset *in, GDALDataset *out, std::string srs_in_str, std::string srs_out_str);
     static void destroy_transform(gdalcubes_transform_info *transform);
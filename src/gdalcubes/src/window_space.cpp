@@ -23,6 +23,8 @@
 */
 #include "window_space.h"
 
+#include "quantile.h"
+
 namespace gdalcubes {
 
 
@@ -135,15 +137,7 @@ struct window_reducer_median : public window_reducer_singleband {
         }
     }
     double finalize() override {
-        if (values.size() == 0) {
-            return NAN;
-        } 
-        std::sort(values.begin(), values.end());
-        if (values.size() % 2 == 1) {
-            return values[values.size() / 2];
-        } else {
-            return (values[values.size() / 2] + values[values.size() / 2 - 1]) / ((double)2);
-        }
+        return quantiles::median(values.data(), values.size());
     }
     std::vector<double> values;
 };
@@ -23,6 +23,8 @@
 */
 #include "window_time.h"
 
+#include "quantile.h"
+
 namespace gdalcubes {
 
 std::function<double(double* buf, uint16_t n)> window_time_cube::get_default_reducer_by_name(std::string name) {
@@ -87,14 +89,16 @@ std::function<double(double* buf, uint16_t n)> window_time_cube::get_default_red
         });
     } else if (name == "median") {
         return std::function<double(double* buf, uint16_t n)>([](double* buf, uint16_t n) {
+            // buf must not be reordered, copy non-NAN values to a local buffer
             std::vector<double> val;
-            val.assign(buf, buf+n); // TODO: handle NAN?
-            std::sort(val.begin(), val.end());
-             if (val.size() % 2 == 1) {
-                return val[val.size() / 2];
-        } else {
-            return (val[val.size() / 2] + val[val.size() / 2 - 1]) / ((double)2);
-        } });
+            val.reserve(n);
+            for (uint16_t i = 0; i < n; ++i) {
+                if (!std::isnan(buf[i])) {
+                    val.push_back(buf[i]);
+                }
+            }
+            return quantiles::median(val.data(), val.size());
+        });
     } else {
         throw std::string("ERROR in window_time_cube::get_default_reducer_by_name(): Unknown reducer '" + name + "'");
     }
@@ -137,7 +141,7 @@ std::shared_ptr<chunk_data> window_time_cube::read_chunk(chunkid_t id) {
     uint32_t chunk_count_l = (uint32_t)std::ceil((double)_win_size_l / (double)(_in_cube->chunk_size()[0]));
     uint32_t chunk_count_r = (uint32_t)std::ceil((double)_win_size_r / (double)(_in_cube->chunk_size()[0]));
 
-    std::shared_ptr<chunk_data> this_chunk = _in_cube->read_chunk(id);
+    std::shared_ptr<chunk_data> this_chunk = _in_cube->read_chunk_cached(id);
     std::vector<std::shared_ptr<chunk_data>> l_chunks;
     std::vector<std::shared_ptr<chunk_data>> r_chunks;
 
@@ -146,13 +150,13 @@ std::shared_ptr<chunk_data> window_time_cube::read_chunk(chunkid_t id) {
         // read l chunks
         int32_t tid = id - i * (_in_cube->count_chunks_x() * _in_cube->count_chunks_y());
         if (tid < 0) break;
-        l_chunks.push_back(_in_cube->read_chunk(tid));
+        l_chunks.push_back(_in_cube->read_chunk_cached(tid));
     }
     for (uint16_t i = 1; i <= chunk_count_r; ++i) {
         // read l chunks
         int32_t tid = id + i * (_in_cube->count_chunks_x() * _in_cube->count_chunks_y());
         if (tid >= (int32_t)_in_cube->count_chunks()) break;
-        r_chunks.push_back(_in_cube->read_chunk(tid));
+        r_chunks.push_back(_in_cube->read_chunk_cached(tid));
     }
 
     // buffer for a single time series including data from adjacent chunks for all used input bands
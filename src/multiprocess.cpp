@@ -1,6 +1,11 @@
 
 #include "multiprocess.h"
+#include "gdalcubes/src/chunk_cache.h"
 #include "gdalcubes/src/cube_factory.h"
+#include "gdalcubes/src/dataset_pool.h"
+#include "gdalcubes/src/image_collection.h"
+#include "gdalcubes/src/ncdf_cube.h"
+#include "gdalcubes/src/stream_process.h"
 #include "gdalcubes/src/external/tiny-process-library/process.hpp"
 #include "error.h"
 
@@ -8,11 +13,430 @@
 #include <Rcpp.h>
 #include <fstream>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace gdalcubes {
 
+/*
+ * Hands out chunks to worker processes on request. Each worker starts with a contiguous part of the chunk
+ * sequence, such that chunks sharing input data are computed by the same process. Workers that
+ * finished their part take chunks from the end of the largest remaining part of another worker.
+ */
+class chunk_dispatcher {
+ public:
+  chunk_dispatcher(std::vector<chunkid_t> chunk_seq, uint16_t nworker) : _chunk_seq(chunk_seq), _parts(nworker) {
+    for (uint16_t pid = 0; pid < nworker; ++pid) {
+      _parts[pid].first = (uint32_t)(((uint64_t)_chunk_seq.size() * pid) / nworker);
+      _parts[pid].second = (uint32_t)(((uint64_t)_chunk_seq.size() * (pid + 1)) / nworker);
+    }
+  }
+  
+  // returns -1 if there are no more chunks
+  int64_t next(uint16_t pid) {
+    if (_parts[pid].first < _parts[pid].second) {
+      return _chunk_seq[_parts[pid].first++];
+    }
+    uint16_t imax = pid;
+    for (uint16_t i = 0; i < _parts.size(); ++i) {
+      if (_parts[i].second - _parts[i].first > _parts[imax].second - _parts[imax].first) {
+        imax = i;
+      }
+    }
+    if (_parts[imax].first < _parts[imax].second) {
+      return _chunk_seq[--_parts[imax].second];
+    }
+    return -1;
+  }
+  
+ private:
+  std::vector<chunkid_t> _chunk_seq;
+  std::vector<std::pair<uint32_t, uint32_t>> _parts;  // [begin, end) in _chunk_seq
+};
+
+// read a chunk file written by a worker process, pass it to f, and remove the file
+static void merge_chunk_file(std::string path, chunkid_t id, std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f, std::mutex &mutex) {
+  try {
+    GCBS_DEBUG("Merging chunk " + std::to_string(id) + " from " + path);
+    std::shared_ptr<chunk_data> dat = std::make_shared<chunk_data>();
+    dat->read_raw(path);
+    if (dat->type() != chunk_data::value_type::FLOAT64) {
+      dat = dat->promote();
+    }
+    f(id, dat, mutex);
+    filesystem::remove(path);
+  } catch (std::string s) {
+    GCBS_ERROR(s);
+    Rcpp::warning("Chunk" + std::to_string(id) + " could not be added to output.");
+  } catch (...) {
+    GCBS_ERROR("unexpected exception while processing chunk");
+    Rcpp::warning("Chunk" + std::to_string(id) + " could not be added to output.");
+  }
+}
+
+#ifndef _WIN32
+// write a message to a pipe without raising SIGPIPE if the other process does not exist anymore
+static bool write_message(int fd, std::string msg) {
+  sigset_t set, old;
+  sigemptyset(&set);
+  sigaddset(&set, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &set, &old);
+  bool ok = ::write(fd, msg.c_str(), msg.size()) == (ssize_t)msg.size();
+  sigset_t pending;
+  sigpending(&pending);
+  if (sigismember(&pending, SIGPIPE)) {
+    int sig;
+    sigwait(&set, &sig);
+  }
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+  return ok;
+}
+
+// read a line from a pipe, waits until data is available, returns false at the end of the pipe or if the parent
+// process has exited, i.e., if the process has been reparented
+static bool read_line(int fd, std::string &line, pid_t parent_pid) {
+  line = "";
+  while (true) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    int r = poll(&pfd, 1, 1000);
+    if (r == 0) {
+      if (getppid() != parent_pid) return false;
+      continue;
+    }
+    char ch;
+    if (r < 0 || ::read(fd, &ch, 1) != 1) return false;
+    if (ch == '\n') return true;
+    line += ch;
+  }
+}
+#endif
+
+std::string chunk_processor_multiprocess::write_worker_json(std::string job_id, uint16_t pid, uint16_t nworker, std::string work_dir, std::string cube_json) {
+  json11::Json::object j_gdal_options;
+  for (auto it = _gdal_options.begin(); it != _gdal_options.end(); ++it) {
+    j_gdal_options[it->first.c_str()] = it->second;
+  }
+  std::string mode = "file";
+  if (config::instance()->get_streaming_mode() == streaming_mode::PIPE) {
+    mode = "pipe";
+  } else if (config::instance()->get_streaming_mode() == streaming_mode::PERSISTENT) {
+    mode = "persistent";
+  }
+  std::string order = "auto";
+  if (config::instance()->get_chunk_order() == chunk_order::ID) {
+    order = "id";
+  } else if (config::instance()->get_chunk_order() == chunk_order::TIME_FIRST) {
+    order = "time_first";
+  } else if (config::instance()->get_chunk_order() == chunk_order::ZORDER) {
+    order = "zorder";
+  }
+  json11::Json j = json11::Json::object{ 
+    {"job_id", job_id},
+    {"worker_id", pid},
+    {"worker_count", nworker},
+    {"job_start", ""}, // TODO
+    {"workdir", work_dir},
+    {"cube", cube_json},
+    {"gdalcubes_options", json11::Json::object{
+      // the cache size applies to a computation, i.e. to all workers together
+      {"chunk_cache_size", (double)config::instance()->get_server_chunkcache_max() / (1024.0 * 1024.0) / (double)nworker},
+      {"chunk_order", order},
+      {"debug", _debug}, 
+      {"log_file", filesystem::join(work_dir, "worker_" + std::to_string(pid) + ".log")},
+      {"ncdf_compression_level", _ncdf_compression_level}, 
+      {"streaming_dir", work_dir},
+      {"streaming_mode", mode},
+      {"use_overview_images", _use_overviews}
+    }},
+    {"gdal_options",j_gdal_options}
+  }; 
+  
+  // write json to file
+  std::ofstream ojson;
+  std::string worker_json_file = filesystem::join(work_dir, "worker_" + std::to_string(pid) + ".json");
+  ojson.open(worker_json_file);
+  ojson << j.dump();
+  ojson.close();
+  return worker_json_file;
+}
+
+void chunk_processor_multiprocess::print_worker_logs() {
+  for (uint16_t pid=0; pid < _log_pos.size(); ++pid) {
+    std::ifstream wlogf(filesystem::join(_pool_dir, "worker_" + std::to_string(pid) + ".log"));
+    if (!wlogf.is_open()) continue;
+    wlogf.seekg(_log_pos[pid]);
+    std::string msg;
+    while (std::getline(wlogf, msg)) {
+      if (!msg.empty()) {
+        std::stringstream sss;
+        sss << "[WORKER #" << std::to_string(pid) << "] " <<  msg << std::endl;
+        r_stderr_buf::print(sss.str());
+      }
+    }
+    wlogf.clear();
+    wlogf.seekg(0, std::ios::end);
+    _log_pos[pid] = wlogf.tellg();
+  }
+}
+
+void chunk_processor_multiprocess::shutdown_pool() {
+#ifndef _WIN32
+  if (_pool.empty()) return;
+  for (uint16_t pid = 0; pid < _pool.size(); ++pid) {
+    if (_task_fd[pid] >= 0) {
+      std::string msg = "Q\n";
+      if (!write_message(_task_fd[pid], msg)) {
+        GCBS_DEBUG("Failed to send quit message to worker process #" + std::to_string(pid));
+      }
+      ::close(_task_fd[pid]);
+    }
+  }
+  // give workers some time to quit, then kill them
+  auto start = std::chrono::steady_clock::now();
+  for (uint16_t pid = 0; pid < _pool.size(); ++pid) {
+    int status;
+    while (!_pool[pid]->try_get_exit_status(status)) {
+      if (std::chrono::steady_clock::now() - start > std::chrono::seconds(2)) {
+        GCBS_DEBUG("killing worker process #" + std::to_string(pid));
+        _pool[pid]->kill(true);
+        _pool[pid]->get_exit_status();
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+  _pool.clear();
+  _task_fd.clear();
+  _log_pos.clear();
+  _notify_buf = "";
+  if (_notify_fd >= 0) ::close(_notify_fd);
+  if (_notify_fd_w >= 0) ::close(_notify_fd_w);
+  _notify_fd = -1;
+  _notify_fd_w = -1;
+  filesystem::remove(_pool_dir);
+  _pool_dir = "";
+#endif
+}
+
+bool chunk_processor_multiprocess::start_pool() {
+#ifdef _WIN32
+  return false;
+#else
+  std::string pool_id = utils::generate_unique_filename();
+  _pool_dir = filesystem::join(config::instance()->get_streaming_dir(), pool_id);
+  if (filesystem::exists(_pool_dir)) {
+    GCBS_DEBUG("Directory '" + _pool_dir + "' for worker processes already exists");
+    _pool_dir = "";
+    return false;
+  }
+  filesystem::mkdir(_pool_dir);
+  GCBS_DEBUG("Starting " + std::to_string(_nworker) + " worker processes using '" + _pool_dir + "' as working directory");
+  
+  std::string fifo_path = filesystem::join(_pool_dir, "chunks.fifo");
+  if (mkfifo(fifo_path.c_str(), 0600) == 0) {
+    _notify_fd = ::open(fifo_path.c_str(), O_RDONLY | O_NONBLOCK);
+    if (_notify_fd >= 0) {
+      _notify_fd_w = ::open(fifo_path.c_str(), O_WRONLY | O_NONBLOCK);
+    }
+  }
+  bool ok = _notify_fd >= 0 && _notify_fd_w >= 0;
+  for (uint16_t pid = 0; ok && pid < _nworker; ++pid) {
+    ok = mkfifo(filesystem::join(_pool_dir, "worker_" + std::to_string(pid) + ".fifo").c_str(), 0600) == 0;
+  }
+  if (!ok) {
+    GCBS_DEBUG("Failed to create named pipes for worker processes");
+    if (_notify_fd >= 0) ::close(_notify_fd);
+    if (_notify_fd_w >= 0) ::close(_notify_fd_w);
+    _notify_fd = -1;
+    _notify_fd_w = -1;
+    filesystem::remove(_pool_dir);
+    _pool_dir = "";
+    return false;
+  }
+  
+  _task_fd.resize(_nworker, -1);
+  _log_pos.resize(_nworker, 0);
+  for (uint16_t pid=0; pid < _nworker; ++pid) {
+    // an empty cube makes the worker wait for jobs from the parent process
+    std::string worker_json_file = write_worker_json(pool_id, pid, _nworker, _pool_dir, "");
+    TinyProcessLib::Config pconf;
+    pconf.show_window = TinyProcessLib::Config::ShowWindow::hide;
+    _pool.push_back(std::make_shared<TinyProcessLib::Process>(
+      _cmd + " " + worker_json_file, "", nullptr,
+      nullptr, false, pconf));
+  }
+  return true;
+#endif
+}
+
+bool chunk_processor_multiprocess::apply_pool(std::shared_ptr<cube> c, std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f) {
+#ifdef _WIN32
+  return false;
+#else
+  if (_pool.empty() && !start_pool()) {
+    return false;
+  }
+  _interrupted = false;
+  std::mutex mutex;
+  uint16_t nworker = _pool.size();
+  
+  std::string json_path = filesystem::join(_pool_dir, "job_" + std::to_string(_job_count++) + ".json");
+  std::ofstream jsonfile(json_path);
+  jsonfile << c->make_constructible_json().dump();
+  jsonfile.close();
+  
+  std::vector<chunkid_t> chunk_seq = c->chunk_sequence(config::instance()->get_chunk_order());
+  chunk_dispatcher dispatcher(chunk_seq, nworker);
+  uint32_t nchunks_done = 0;
+  std::vector<bool> worker_active(nworker, false);  // worker has received the job and not yet the end of job message
+  std::vector<uint32_t> worker_chunks(nworker, 0);
+  std::vector<double> worker_busy_ms(nworker, 0.0);
+  
+  auto send = [this](uint16_t pid, std::string msg) {
+    if (!write_message(_task_fd[pid], msg)) {
+      GCBS_WARN("Failed to send message to worker process #" + std::to_string(pid));
+    }
+  };
+  auto send_next_chunk = [&](uint16_t pid) {
+    int64_t id = dispatcher.next(pid);
+    if (id < 0) {
+      worker_active[pid] = false;
+    }
+    send(pid, std::to_string(id) + "\n");
+  };
+  
+  // workers that are already connected start immediately, others when they report to be ready
+  for (uint16_t pid = 0; pid < nworker; ++pid) {
+    if (_task_fd[pid] >= 0) {
+      send(pid, "J " + json_path + "\n");
+      worker_active[pid] = true;
+    }
+  }
+  
+  bool any_failed = false;
+  auto start = std::chrono::system_clock::now();
+  while (nchunks_done < chunk_seq.size() || std::find(worker_active.begin(), worker_active.end(), true) != worker_active.end()) {
+    for (uint16_t pid = 0; pid < nworker; ++pid) {
+      int status;
+      if (_pool[pid]->try_get_exit_status(status)) {
+        GCBS_ERROR("worker process #" + std::to_string(pid) + " returned " + std::to_string(status));
+        any_failed = true;
+      }
+    }
+    if (any_failed) {
+      break;
+    }
+    
+    // Messages are lines "H <worker>" (worker is ready), "R <worker>" (request for a chunk), or
+    // "D <worker> <chunk> <milliseconds> <written>" (chunk has been computed and written to a file
+    // if <written> is 1, also requests the next chunk)
+    std::vector<std::pair<std::string, chunkid_t>> chunk_queue;
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::read(_notify_fd, buf, sizeof(buf))) > 0) {
+      _notify_buf.append(buf, n);
+    }
+    std::size_t pos;
+    while ((pos = _notify_buf.find('\n')) != std::string::npos) {
+      std::istringstream line(_notify_buf.substr(0, pos));
+      _notify_buf.erase(0, pos + 1);
+      char type = 0;
+      int wid = -1;
+      line >> type >> wid;
+      if (line.fail() || wid < 0 || wid >= nworker) continue;
+      if (type == 'H') {
+        if (_task_fd[wid] < 0) {
+          _task_fd[wid] = ::open(filesystem::join(_pool_dir, "worker_" + std::to_string(wid) + ".fifo").c_str(), O_WRONLY | O_NONBLOCK);
+        }
+        if (_task_fd[wid] >= 0 && !worker_active[wid]) {
+          send(wid, "J " + json_path + "\n");
+          worker_active[wid] = true;
+        }
+        continue;
+      }
+      if (type == 'D') {
+        chunkid_t chunkid;
+        double ms;
+        int written;
+        line >> chunkid >> ms >> written;
+        if (line.fail()) continue;
+        nchunks_done++;
+        worker_chunks[wid]++;
+        worker_busy_ms[wid] += ms;
+        if (written) {
+          chunk_queue.push_back(std::make_pair<>(filesystem::join(_pool_dir, std::to_string(chunkid) + ".chunk"), chunkid));
+        }
+      }
+      if (worker_active[wid]) {
+        send_next_chunk(wid);
+      }
+    }
+    
+    for (auto it = chunk_queue.begin(); it != chunk_queue.end(); ++it) {
+      merge_chunk_file(it->first, it->second, f, mutex);
+    }
+    
+    auto end = std::chrono::system_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    if (elapsed > std::chrono::milliseconds(1500)) {
+      try {
+        Rcpp::checkUserInterrupt();
+      }
+      catch (...) {
+        _interrupted = true;
+        break;
+      }
+      start = std::chrono::system_clock::now();
+    }
+    struct pollfd pfd = {_notify_fd, POLLIN, 0};
+    poll(&pfd, 1, 200);
+  }
+  filesystem::remove(json_path);
+  
+  for (uint16_t pid = 0; pid < nworker; ++pid) {
+    if (worker_chunks[pid] > 0) {
+      GCBS_DEBUG("Worker process #" + std::to_string(pid) + " computed " + std::to_string(worker_chunks[pid]) + " chunks in " +
+        std::to_string(worker_busy_ms[pid] / 1000.0) + "s (" + std::to_string(1000.0 * worker_chunks[pid] / std::max(worker_busy_ms[pid], 1.0)) + " chunks/s)");
+    }
+  }
+  
+  if (_debug || any_failed) {
+    print_worker_logs();
+  }
+  if (_interrupted || any_failed) {
+    // workers might still compute chunks of this job, start a new pool for the next computation
+    shutdown_pool();
+  }
+  r_stderr_buf::print(); // make sure that deferred output is printed
+  
+  if(_interrupted) {
+    _interrupted = false;
+    GCBS_ERROR("computations have been interrupted by the user");
+    Rcpp::stop("computations have been interrupted by the user");
+  }
+  else if (any_failed) {
+    Rcpp::stop("one or more worker processes failed to compute data cube chunks");
+  }
+  return true;
+#endif
+}
+
+
 void chunk_processor_multiprocess::apply(std::shared_ptr<cube> c,
                                          std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f) {
   
+  if (apply_pool(c, f)) {
+    return;
+  }
+  
+  // Without named pipes (e.g. on Windows), worker processes are started for this computation only, compute
+  // statically assigned chunks, and results are found by scanning the working directory
   GCBS_DEBUG("Using " + std::to_string(this->_nworker) + " worker");
   _interrupted = false;
   
@@ -40,35 +464,8 @@ void chunk_processor_multiprocess::apply(std::shared_ptr<cube> c,
   std::vector<int> exit_status(nworker, -1);
   
   
-  json11::Json::object j_gdal_options;
-  for (auto it = _gdal_options.begin(); it != _gdal_options.end(); ++it) {
-    j_gdal_options[it->first.c_str()] = it->second;
-  }
-  
   for (uint16_t pid=0; pid < nworker; ++pid) {
-    json11::Json j = json11::Json::object{ 
-      {"job_id", job_id},
-      {"worker_id", pid},
-      {"worker_count", nworker},
-      {"job_start", ""}, // TODO
-      {"workdir", work_dir},
-      {"cube", filesystem::join(work_dir, "cube.json")},
-      {"gdalcubes_options", json11::Json::object{
-        {"debug", _debug}, 
-        {"log_file", filesystem::join(work_dir, "worker_" + std::to_string(pid) + ".log")},
-        {"ncdf_compression_level", _ncdf_compression_level}, 
-        {"streaming_dir", work_dir},
-        {"use_overview_images", _use_overviews}
-      }},
-      {"gdal_options",j_gdal_options}
-    }; 
-    
-    // write json to file
-    std::ofstream ojson;
-    std::string worker_json_file = filesystem::join(work_dir, "worker_" + std::to_string(pid) + ".json");
-    ojson.open(worker_json_file);
-    ojson << j.dump();
-    ojson.close();
+    std::string worker_json_file = write_worker_json(job_id, pid, nworker, work_dir, filesystem::join(work_dir, "cube.json"));
     
     // start child process, with first argument being path to the json worker process description
     TinyProcessLib::Config pconf;
@@ -108,10 +505,10 @@ void chunk_processor_multiprocess::apply(std::shared_ptr<cube> c,
     std::vector<std::pair<std::string, chunkid_t>> chunk_queue;
     filesystem::iterate_directory(work_dir, [&chunk_queue](const std::string& f) {
       
-      // Consider files with name X.nc, where X is an integer number
+      // Consider files with name X.chunk, where X is an integer number
       // Temporary files will start with a dot and are NOT considered here
       std::string basename  = filesystem::stem(f) + "." + filesystem::extension(f);
-      std::size_t pos = basename.find(".nc");
+      std::size_t pos = basename.find(".chunk");
       if (pos > 0 && pos < std::string::npos) {
         try {
             int chunkid = std::stoi(basename.substr(0,pos));
@@ -123,26 +520,7 @@ void chunk_processor_multiprocess::apply(std::shared_ptr<cube> c,
   
     // add finished chunks to output
     for (auto it = chunk_queue.begin(); it != chunk_queue.end(); ++it) {
-      try {
-        GCBS_DEBUG("Merging chunk " + std::to_string(it->second) + " from " + it->first);
-        std::shared_ptr<chunk_data> dat = std::make_shared<chunk_data>();
-        dat->read_ncdf(it->first);
-        f(it->second, dat, mutex);
-        filesystem::remove(it->first);
-
-        // for debugging only
-        //filesystem::move(it->first,it->first + "DONE.nc");
-
-
-      } catch (std::string s) {
-        GCBS_ERROR(s);
-        Rcpp::warning("Chunk" + std::to_string(it->second) + " could not be added to output.");
-        continue;
-      } catch (...) {
-        GCBS_ERROR("unexpected exception while processing chunk");
-        Rcpp::warning("Chunk" + std::to_string(it->second) + " could not be added to output.");
-        continue;
-      }
+      merge_chunk_file(it->first, it->second, f, mutex);
     }
     
     
@@ -163,7 +541,6 @@ void chunk_processor_multiprocess::apply(std::shared_ptr<cube> c,
       std::this_thread::sleep_for(std::chrono::milliseconds(200));
     }
   }
-  
   if (_interrupted) {
     for (uint16_t pid=0; pid < nworker; ++pid) {
       if(!p[pid]->try_get_exit_status(exit_status[pid])) {
@@ -230,21 +607,130 @@ void chunk_processor_multiprocess::apply(std::shared_ptr<cube> c,
 }
 
 void chunk_processor_multiprocess::exec(std::string json_path, uint16_t pid, uint16_t nworker, std::string work_dir, int ncdf_compression_level) {
-  std::shared_ptr<cube> cube = cube_factory::instance()->create_from_json_file(json_path);
-  
-  for (uint32_t i=pid; i<cube->count_chunks(); i+= nworker) {
-    chunkid_t id = i;
-    std::string outfile =  filesystem::join(work_dir, std::to_string(id) + ".nc");
-    std::string outfile_temp =  filesystem::join(work_dir, "." + std::to_string(id) + ".nc");
+  // compute a chunk and write it to a file, returns false if the chunk is empty and has not been written
+  auto process_chunk = [&work_dir](std::shared_ptr<cube> cube, chunkid_t id) -> bool {
+    std::string outfile =  filesystem::join(work_dir, std::to_string(id) + ".chunk");
+    std::string outfile_temp =  filesystem::join(work_dir, "." + std::to_string(id) + ".chunk");
     
     // TODO: exception handling?!
-    cube->read_chunk(id)->write_ncdf(outfile_temp, ncdf_compression_level, false); 
-    if (filesystem::exists(outfile_temp)) {
-      filesystem::move(outfile_temp, outfile);
+    std::shared_ptr<chunk_data> dat = cube->read_chunk(id);
+    if (dat->status() == chunk_data::chunk_status::OK && dat->all_nan()) {
+      return false; // empty chunks are not transferred
     }
-    // TODO: error handling / exceptions
+    // reduce the amount of data to be transferred, e.g. for integer data
+    std::shared_ptr<chunk_data> dat_compact = dat->compact();
+    if (dat_compact) {
+      dat = dat_compact;
+    }
+    dat->write_raw(outfile_temp);
+    filesystem::move(outfile_temp, outfile);
+    return true;
+  };
+
+  if (json_path.empty()) {
+#ifndef _WIN32
+    // Worker of a persistent pool, receives lines "J <cube json file>" (new job) or "Q" (quit) and
+    // chunk ids from the parent process, where -1 marks the end of a job
+    pid_t parent_pid = getppid();
+    
+    // the parent process keeps the pipe open, opening for writing fails only if it is not available
+    int notify_fd = ::open(filesystem::join(work_dir, "chunks.fifo").c_str(), O_WRONLY | O_NONBLOCK);
+    if (notify_fd < 0) {
+      GCBS_ERROR("Failed to connect to parent process");
+      return;
+    }
+    fcntl(notify_fd, F_SETFL, fcntl(notify_fd, F_GETFL) & ~O_NONBLOCK);
+    std::string task_fifo = filesystem::join(work_dir, "worker_" + std::to_string(pid) + ".fifo");
+    int task_fd = ::open(task_fifo.c_str(), O_RDONLY | O_NONBLOCK);
+    // The write end keeps the pipe open until the parent process has connected, afterwards
+    // the end of the pipe indicates that the parent process does not exist anymore
+    int task_fd_w = task_fd >= 0 ? ::open(task_fifo.c_str(), O_WRONLY | O_NONBLOCK) : -1;
+    if (task_fd < 0 || task_fd_w < 0) {
+      GCBS_ERROR("Failed to open named pipe '" + task_fifo + "'");
+      if (task_fd >= 0) ::close(task_fd);
+      ::close(notify_fd);
+      return;
+    }
+    auto notify = [notify_fd](std::string msg) {
+      // messages are shorter than PIPE_BUF, hence written atomically
+      if (!write_message(notify_fd, msg)) {
+        GCBS_WARN("Failed to send message to parent process");
+      }
+    };
+    auto receive = [&](std::string &line) -> bool {
+      if (!read_line(task_fd, line, parent_pid)) return false;
+      if (task_fd_w >= 0) {
+        ::close(task_fd_w);
+        task_fd_w = -1;
+      }
+      return true;
+    };
+    
+    notify("H " + std::to_string(pid) + "\n");
+    std::string line;
+    while (receive(line)) {
+      if (line == "Q") break;
+      if (line.size() < 3 || line[0] != 'J') continue;
+      // pooled datasets are kept open across jobs unless their files have been modified in between
+      gdal_dataset_pool::instance()->revalidate();
+      image_collection::next_query_batch();
+      std::shared_ptr<cube> cube;
+      try {
+        cube = cube_factory::instance()->create_from_json_file(line.substr(2));
+      } catch (std::string s) {
+        GCBS_ERROR(s);
+        break;  // the parent process detects failure from the exit of this process
+      }
+      notify("R " + std::to_string(pid) + "\n");
+      while (receive(line)) {
+        int64_t id = -1;
+        try {
+          id = std::stoll(line);
+        } catch (...) {}
+        if (id < 0) break;
+        auto t0 = std::chrono::steady_clock::now();
+        bool written = process_chunk(cube, (chunkid_t)id);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        notify("D " + std::to_string(pid) + " " + std::to_string(id) + " " + std::to_string(ms) + " " + (written ? "1" : "0") + "\n");
+      }
+      cube = nullptr;
+      
+      // cubes of the next job have new ids, cached chunks of this job would never be used again
+      stream_process::stop_all();
+      chunk_cache::instance()->clear();
+      ncdf_cube::close_files();
+    }
+    if (task_fd_w >= 0) ::close(task_fd_w);
+    ::close(task_fd);
+    ::close(notify_fd);
+#else
+    GCBS_ERROR("Missing data cube for worker process");
+#endif
+    return;
+  }
+
+  // Static assignment if workers are started for a single computation. For locality-aware orders, each worker
+  // gets a contiguous part of the sequence, such that chunks sharing input data are computed by the same process.
+  std::shared_ptr<cube> cube = cube_factory::instance()->create_from_json_file(json_path);
+  chunk_order order = config::instance()->get_chunk_order();
+  if (order == chunk_order::AUTO) {
+    order = cube->suggest_chunk_order();
+  }
+  std::vector<chunkid_t> chunks = cube->chunk_sequence(order);
+  uint32_t nchunks = chunks.size();
+  uint32_t istart = pid;
+  uint32_t iend = nchunks;
+  uint32_t istep = nworker;
+  if (order != chunk_order::ID) {
+    istart = (uint32_t)(((uint64_t)nchunks * pid) / nworker);
+    iend = (uint32_t)(((uint64_t)nchunks * (pid + 1)) / nworker);
+    istep = 1;
   }
   
+  for (uint32_t i=istart; i<iend; i+= istep) {
+    process_chunk(cube, chunks[i]);
+    // TODO: error handling / exceptions
+  }
 }
 
 }
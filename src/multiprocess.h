@@ -3,14 +3,34 @@
 
 
 #include "gdalcubes/src/cube.h"
+#include <ios>
 #include <unordered_map>
 
+namespace TinyProcessLib {
+  class Process;
+}
+
 namespace gdalcubes {
+
+  /**
+   * @brief Chunk processor that computes chunks in separate R worker processes
+   * 
+   * On Unix-like systems, worker processes are started once and then kept alive as a pool across subsequent
+   * computations, such that the R package, GDAL, and caches must not be initialized for each computation. 
+   * Workers receive the cube to compute as JSON file and request chunks from the parent process over named pipes. 
+   * The pool is shut down when the configuration changes, when a computation fails or is interrupted, and when the
+   * chunk processor is destroyed. On Windows, worker processes are started for each computation.
+   */
   class chunk_processor_multiprocess : public chunk_processor {
   public:
     
     chunk_processor_multiprocess() : _cmd(""), _interrupted(false), _nworker(1), _debug(false), _use_overviews(true), 
-                                     _ncdf_compression_level(0), _gdal_options() {}
+                                     _ncdf_compression_level(0), _gdal_options(), _pool(), _pool_dir(""), _notify_fd(-1),
+                                     _notify_fd_w(-1), _task_fd(), _log_pos(), _notify_buf(""), _job_count(0) {}
+    
+    ~chunk_processor_multiprocess() {
+      shutdown_pool();
+    }
     
     uint32_t max_threads() override {
       return 1;
@@ -20,38 +40,62 @@ namespace gdalcubes {
     }
     
     void set_cmd(std::string cmd) {
+      shutdown_pool();
       _cmd = cmd;
     }
     
     void set_nworker(uint16_t n) {
+      shutdown_pool();
       _nworker = n;
     }
     
     void set_debug(bool debug) {
+      shutdown_pool();
       _debug = debug;
     }
     
     void set_ncdf_compression_level(int l) {
+      shutdown_pool();
       _ncdf_compression_level = l;
     }
     
     void set_use_overviews(bool v) {
+      shutdown_pool();
       _use_overviews = v;
     }
     
     void set_gdal_options(std::unordered_map<std::string, std::string> gdal_options) {
+      shutdown_pool();
       _gdal_options = gdal_options;
     }
     
     void apply(std::shared_ptr<cube> c,
                std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f) override;
     
+    /**
+     * Compute chunks of a cube in a worker process
+     * @param json_path path to the JSON description of the cube, if empty, the worker is part of a persistent pool
+     * and receives cubes from the parent process
+     * @param pid worker id
+     * @param nworker number of workers
+     * @param work_dir working directory shared with the parent process
+     * @param ncdf_compression_level unused
+     */
     static void exec(std::string json_path, uint16_t pid, uint16_t nworker, std::string work_dir, int ncdf_compression_level = 0);
     void kill_all() {_interrupted = true;}
     
-    
+    /**
+     * Stop all worker processes of the pool, if running
+     */
+    void shutdown_pool();
     
   private:
+    bool start_pool();
+    bool apply_pool(std::shared_ptr<cube> c, std::function<void(chunkid_t, std::shared_ptr<chunk_data>, std::mutex &)> f);
+    void print_worker_logs();
+    std::string write_worker_json(std::string job_id, uint16_t pid, uint16_t nworker, std::string work_dir, std::string cube_json);
+    
+
     std::string _cmd;
     bool _interrupted;
     uint16_t _nworker;
@@ -59,6 +103,15 @@ namespace gdalcubes {
     bool _use_overviews;
     int _ncdf_compression_level;
     std::unordered_map<std::string, std::string> _gdal_options;
+    
+    std::vector<std::shared_ptr<TinyProcessLib::Process>> _pool;
+    std::string _pool_dir;
+    int _notify_fd;
+    int _notify_fd_w;
+    std::vector<int> _task_fd;
+    std::vector<std::streamoff> _log_pos;
+    std::string _notify_buf;
+    uint32_t _job_count;
   };
 }
 